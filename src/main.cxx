@@ -11,31 +11,84 @@
 
 #include "it_s_work.h"
 
+#include <chrono>
+#include <cstdlib>
 #include <iostream>
 #include <random>
 #include <vector>
 #include <cmath>
+#include <memory>
+#include <string>
 #include "model/vec2.h"
 #include "model/boid.h"
 #include "model/flock.h"
+#include "model/flock_analytics.h"
+#include "model/chunked_world.h"
+#include "utility/camera.h"
 #include "utility/renderer.h"
+#include "utility/frame_exporter.h"
+#include "utility/layer_cache.h"
+#include "utility/quality_controller.h"
+#include "utility/job_system.h"
+#include "utility/state_publisher.h"
 
 int const NUM_BOIDS = 100;
-int const WIDTH = 800;
+int const WIDTH = 800;  // window size; the world size defaults to the same (--world)
 int const HEIGHT = 600;
 float const PI = M_PI; // 3.1415927; // TODO: better PI
-
-Flock myFlock(NUM_BOIDS, WIDTH, HEIGHT);
+float const BOID_SIZE = 10.0f;
+int const HEATMAP_CELL = 8; // pixels per density cell at the heatmap level of detail
 
 struct global_t {
 	SDL_Window * window = NULL;
 	SDL_Renderer * renderer = NULL;
 
+	// simulation, created once the world size is known
+	std::unique_ptr<Flock> flock;
+	int world_width = WIDTH;
+	int world_height = HEIGHT;
+	Camera camera{(float)WIDTH, (float)HEIGHT, WIDTH, HEIGHT};
+
+	// one scheduler for simulation, analytics and render preparation
+	std::unique_ptr<JobSystem> jobs;
+	std::vector<SDL_Point> boid_outlines; // built by prepare_render()
+
+	// static content that is expensive to draw, cached in textures under the boids
+	std::unique_ptr<LayerCache> layers;
+	int logo_layer = -1;
+	bool show_logo = false;
+
+	// adaptive quality (--adaptive); without it: triangles, one substep, all boids
+	std::unique_ptr<QualityController> quality;
+	QualityController::Lod lod = QualityController::Lod::TRIANGLES;
+	std::vector<SDL_Point> boid_points;   // points level of detail
+	std::vector<Uint32> density;          // heatmap level of detail
+	SDL_Texture * heatmap = NULL;
+	std::vector<Boid> parked;             // boids taken out of the flock by the controller
+	double update_ms = 0.0;
+	double render_ms = 0.0;
+
 	// random
 	std::random_device rd;
 	std::default_random_engine eng;
 	std::uniform_real_distribution<float> rand;
 
+	// frame export (--record)
+	std::unique_ptr<FrameExporter> exporter;
+	SDL_Texture * frame_target = NULL; // offscreen target frames are rendered into
+	bool frame_pending = false; // frame_target holds a frame not read back yet
+	long record_frames = -1; // stop after this many frames, -1 = until closed
+
+	// flock metrics stream (--analytics)
+	std::unique_ptr<FlockAnalytics> analytics;
+
+	// chunk paging for large worlds (--chunked), nullptr = whole flock simulated
+	std::unique_ptr<ChunkedWorld> world;
+
+	// shared-memory state ring for external readers (--publish)
+	std::unique_ptr<StatePublisher> publisher;
+	std::uint64_t step = 0;
+
 };
 
 global_t g;
@@ -45,13 +98,38 @@ void paint_it_s_work(int ox, int oy, int scale = 20) {
 	for (int j = 0; j < px::height; ++j) {
 		for (int i = 0; i < px::width; ++i) {
 			if (px::header_data[j*px::width+i] == 0) {
-				SDL_Rect r = { i*scale+ox, j*scale+oy, 20, 20 };
+				SDL_Rect r = { i*scale+ox, j*scale+oy, scale, scale };
 				SDL_RenderFillRect(g.renderer, &r);
 			}
 		}
 	}
 }
 
+// One rectangle per dark pixel: worth caching, unlike the clear and the boundary outline
+void paint_logo(SDL_Renderer *, int width, int height) {
+	int scale = std::max(1, width / (int)px::width);
+	paint_it_s_work((width - (int)px::width * scale) / 2, (height - (int)px::height * scale) / 2, scale);
+}
+
+void create_layers() {
+	g.layers.reset(new LayerCache(g.renderer, WIDTH, HEIGHT));
+	g.logo_layer = g.layers->add(paint_logo, false);
+	g.layers->set_visible(g.logo_layer, g.show_logo);
+}
+
+/**
+ * @brief (Re)creates the offscreen texture recorded frames are rendered into.
+ */
+bool create_frame_target() {
+	if (g.frame_target) {
+		SDL_DestroyTexture(g.frame_target);
+	}
+	g.frame_target = SDL_CreateTexture(g.renderer, SDL_PIXELFORMAT_RGBA8888,
+			SDL_TEXTUREACCESS_TARGET, WIDTH, HEIGHT);
+	g.frame_pending = false;
+	return g.frame_target != NULL;
+}
+
 
 /**
  * @brief Renders a filled circle using the SDL Renderer API.
@@ -90,27 +168,183 @@ void draw_filled_circle(int center_x, int center_y, int radius) {
 }
 
 
+/**
+ * @brief Copies the frame left in frame_target (the current render target) into a pooled
+ * buffer and queues it for writing.
+ * If every buffer is still in flight the frame is dropped rather than waiting on the writer.
+ */
+void export_frame() {
+    g.frame_pending = false;
+    if (g.record_frames == 0) {
+        return;
+    }
+    std::uint8_t * frame = g.exporter->acquire();
+    if (not frame) {
+        return;
+    }
+    if (SDL_RenderReadPixels(g.renderer, NULL, SDL_PIXELFORMAT_RGB24, frame, g.exporter->pitch()) != 0) {
+        g.exporter->release(frame);
+        return;
+    }
+    g.exporter->submit(frame);
+    if (g.record_frames > 0) {
+        g.record_frames--;
+    }
+}
+
 void do_render() {
-    // 1. Clear the screen (White background)
+    // When recording, draw into the offscreen target so it can be read back.
+    // SDL2 only reads back synchronously, so the previous frame is read here,
+    // one frame late, when the GPU has long finished it
+    if (g.frame_target) {
+        SDL_SetRenderTarget(g.renderer, g.frame_target);
+        if (g.frame_pending) {
+            export_frame();
+        }
+    }
+
+    // 1. Background and world boundaries (cheap, drawn directly), then cached layers
     SDL_SetRenderDrawColor(g.renderer, 255u, 255u, 255u, SDL_ALPHA_OPAQUE);
     SDL_RenderClear(g.renderer);
+    Renderer::draw_boundaries(g.renderer, g.camera);
+    g.layers->composite();
+
+    // 2. Draw all Boids (visible ones only, prepared by prepare_render)
+    switch (g.lod) {
+        case QualityController::Lod::TRIANGLES:
+            Renderer::draw_outlines(g.renderer, g.boid_outlines);
+            break;
+        case QualityController::Lod::POINTS:
+            Renderer::draw_points(g.renderer, g.boid_points);
+            break;
+        case QualityController::Lod::HEATMAP:
+            if (not g.heatmap) {
+                g.heatmap = SDL_CreateTexture(g.renderer, SDL_PIXELFORMAT_RGBA8888, SDL_TEXTUREACCESS_STREAMING,
+                        WIDTH / HEATMAP_CELL, HEIGHT / HEATMAP_CELL);
+                SDL_SetTextureBlendMode(g.heatmap, SDL_BLENDMODE_BLEND);
+            }
+            if (g.heatmap) {
+                SDL_UpdateTexture(g.heatmap, NULL, g.density.data(), (WIDTH / HEATMAP_CELL) * 4);
+                SDL_RenderCopy(g.renderer, g.heatmap, NULL, NULL);
+            }
+            break;
+    }
 
-    // 2. Draw all Boids
-    float const BOID_SIZE = 10.0f;
-    
-    // Get the boids collection from the Flock object
-    for (const Boid& b : myFlock.get_boids()) {
-        Renderer::draw_oriented_boid(g.renderer, b, BOID_SIZE);
+    // 3. Show the frame in the window; it is exported at the start of the next one
+    if (g.frame_target) {
+        g.frame_pending = true;
+        SDL_SetRenderTarget(g.renderer, NULL);
+        SDL_RenderCopy(g.renderer, g.frame_target, NULL, NULL);
     }
 
-    // 3. Present the rendered scene
-    SDL_RenderPresent(g.renderer);
+    // 4. The caller presents the scene (presenting may wait for vsync)
+}
+
+/**
+ * @brief Parks or restores boids so the flock holds the controller's active count.
+ * Parked boids keep their state and come back where they left.
+ */
+void apply_active_boids(int active) {
+    int const n = (int)g.flock->get_boids().size();
+    if (n > active) {
+        // extract_boids visits boids in order: park the tail of the vector
+        int seen = 0;
+        g.flock->extract_boids([&](Boid const &) { return seen++ >= active; }, g.parked);
+    } else if (n < active && not g.parked.empty()) {
+        std::size_t count = std::min((std::size_t)(active - n), g.parked.size());
+        g.flock->add_boids(g.parked.data() + g.parked.size() - count, count);
+        g.parked.resize(g.parked.size() - count);
+    }
 }
 
 void do_update() {
     float const DT = 0.1f;
-    // Delegate the update logic to the Flock object
-    myFlock.update(DT, WIDTH, HEIGHT);
+    auto start = std::chrono::steady_clock::now();
+    g.step++;
+
+    int substeps = 1;
+    if (g.quality) {
+        QualityController::State const & q = g.quality->get_state();
+        substeps = q.substeps;
+        if (q.active_boids > 0) {
+            apply_active_boids(q.active_boids);
+        }
+    }
+
+    // Same simulated time per frame; more substeps only refine the integration
+    for (int k = 0; k < substeps; ++k) {
+        if (g.world) {
+            // Simulate in full what the camera sees (plus a chunk of slack around it)
+            float x0, y0, x1, y1;
+            g.camera.visible_rect(0.0f, x0, y0, x1, y1);
+            g.world->set_focus(x0, y0, x1, y1);
+            g.world->update(DT / substeps);
+        } else {
+            // Delegate the update logic to the Flock object
+            g.flock->update(DT / substeps, g.world_width, g.world_height);
+        }
+    }
+
+    std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+    g.update_ms = elapsed.count();
+}
+
+void publish_state() {
+    // Reads the flock concurrently with prepare_render(); both are read-only
+    g.publisher->publish(g.flock->get_boids(), g.step);
+}
+
+void prepare_render() {
+    // Only reads the flock; SDL calls stay on the main thread in do_render()
+    auto start = std::chrono::steady_clock::now();
+    switch (g.lod) {
+        case QualityController::Lod::TRIANGLES:
+            Renderer::build_flock_outlines(*g.flock, g.camera, BOID_SIZE, g.boid_outlines, g.jobs.get());
+            break;
+        case QualityController::Lod::POINTS:
+            Renderer::build_flock_points(*g.flock, g.camera, g.boid_points);
+            break;
+        case QualityController::Lod::HEATMAP:
+            Renderer::build_density(*g.flock, g.camera, WIDTH / HEATMAP_CELL, HEIGHT / HEATMAP_CELL, g.density);
+            break;
+    }
+    std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+    g.render_ms = elapsed.count();
+}
+
+/**
+ * @brief Runs one frame as a task graph: update -> render preparation, then
+ * draws on the main thread. The main thread executes tasks while it waits.
+ */
+void do_frame() {
+    JobSystem& jobs = *g.jobs;
+    JobSystem::TaskRef update = jobs.create(do_update);
+    JobSystem::TaskRef prepare = jobs.create(prepare_render);
+    jobs.depend(prepare, update);
+    JobSystem::TaskRef publish;
+    if (g.publisher) {
+        publish = jobs.create(publish_state);
+        jobs.depend(publish, update);
+    }
+    jobs.submit(update);
+    jobs.submit(prepare);
+    if (publish) {
+        jobs.submit(publish);
+        jobs.wait(publish);
+    }
+    jobs.wait(prepare);
+
+    auto start = std::chrono::steady_clock::now();
+    do_render();
+    std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+    SDL_RenderPresent(g.renderer);
+
+    if (g.quality) {
+        // Work time only: waiting for events or vsync is not frame cost.
+        // The new level of detail applies from the next frame's preparation
+        g.quality->record(g.update_ms, g.render_ms + elapsed.count());
+        g.lod = g.quality->get_state().lod;
+    }
 }
 
 // void do_render() {
@@ -128,11 +362,191 @@ void do_update() {
 
 // }
 
+/**
+ * @brief Camera controls: arrows/WASD pan, +/- or the mouse wheel zoom,
+ * left-drag pans and Home fits the whole world in the window.
+ */
+void handle_camera_event(SDL_Event const & event) {
+	float const PAN_STEP = 50.0f; // pixels per key press
+	float const ZOOM_STEP = 1.25f;
+	Vec2 const view_center = {WIDTH * 0.5f, HEIGHT * 0.5f};
+
+	switch (event.type) {
+	case SDL_KEYDOWN:
+		switch (event.key.keysym.sym) {
+			case SDLK_LEFT: case SDLK_a: g.camera.pan(-PAN_STEP, 0.0f); break;
+			case SDLK_RIGHT: case SDLK_d: g.camera.pan(PAN_STEP, 0.0f); break;
+			case SDLK_UP: case SDLK_w: g.camera.pan(0.0f, -PAN_STEP); break;
+			case SDLK_DOWN: case SDLK_s: g.camera.pan(0.0f, PAN_STEP); break;
+			case SDLK_PLUS: case SDLK_EQUALS: case SDLK_KP_PLUS: g.camera.zoom_at(ZOOM_STEP, view_center); break;
+			case SDLK_MINUS: case SDLK_KP_MINUS: g.camera.zoom_at(1.0f / ZOOM_STEP, view_center); break;
+			case SDLK_HOME: g.camera.fit_world(); break;
+			case SDLK_l:
+				g.show_logo = not g.show_logo;
+				g.layers->set_visible(g.logo_layer, g.show_logo);
+				break;
+			default: break;
+		}
+		break;
+	case SDL_MOUSEWHEEL: {
+		int mx, my;
+		SDL_GetMouseState(&mx, &my);
+		float factor = event.wheel.y > 0 ? ZOOM_STEP : 1.0f / ZOOM_STEP;
+		if (event.wheel.y != 0) {
+			g.camera.zoom_at(factor, Vec2{(float)mx, (float)my});
+		}
+		break;
+	}
+	case SDL_MOUSEMOTION:
+		if (event.motion.state & SDL_BUTTON_LMASK) {
+			g.camera.pan((float)-event.motion.xrel, (float)-event.motion.yrel);
+		}
+		break;
+	}
+}
+
+void usage(char const * name) {
+	std::cerr << "usage: " << name << " [--world WIDTH HEIGHT] [--threads N] [--deterministic] [--multirate]\n"
+	          << "       [--boids N] [--chunked CHUNK_SIZE] [--chunk-budget MB] [--chunk-dir DIR]\n"
+	          << "       [--publish SHM_NAME] [--adaptive] [--frame-budget MS] [--adaptive-boids]\n"
+	          << "       [--max-substeps N]\n"
+	          << "       [--record TARGET] [--record-format raw|y4m|ppm|pipe] [--record-frames N]\n"
+	          << "       [--analytics FILE] [--analytics-format csv|bin] [--analytics-every STEPS]\n"
+	          << "       [--analytics-budget PERCENT]\n"
+	          << "  TARGET is a file (raw, y4m), a name pattern (ppm, e.g. frame_%05d.ppm)\n"
+	          << "  or a shell command reading RGB24 frames on stdin (pipe)\n"
+	          << "  --chunk-dir must be on a disk-backed file system (default /var/tmp);\n"
+	          << "  evicted chunks in a tmpfs directory such as /tmp still take RAM\n";
+}
+
 int main(int argc, char ** argv)
 {
+	std::string record_target;
+	FrameExporter::Format record_format = FrameExporter::Format::Y4M;
+	std::string analytics_path;
+	FlockAnalytics::Format analytics_format = FlockAnalytics::Format::CSV;
+	int analytics_every = 10;
+	double analytics_budget = 3.0; // percent of update time, 0 = no limit
+	int threads = 1;
+	bool deterministic = false;
+	bool multirate = false;
+	int num_boids = NUM_BOIDS;
+	float chunk_size = 0.0f;
+	ChunkedWorld::Config chunk_config;
+	std::string publish_name;
+	bool adaptive = false;
+	QualityController::Config quality_config;
+
+	for (int i = 1; i < argc; ++i) {
+		std::string arg = argv[i];
+		if (arg == "--world" && i + 2 < argc) {
+			g.world_width = std::atoi(argv[++i]);
+			g.world_height = std::atoi(argv[++i]);
+			if (g.world_width <= 0 || g.world_height <= 0) {
+				usage(argv[0]);
+				return 1;
+			}
+		} else if (arg == "--threads" && i + 1 < argc) {
+			threads = std::atoi(argv[++i]);
+		} else if (arg == "--deterministic") {
+			deterministic = true;
+		} else if (arg == "--multirate") {
+			multirate = true;
+		} else if (arg == "--boids" && i + 1 < argc) {
+			num_boids = std::atoi(argv[++i]);
+		} else if (arg == "--chunked" && i + 1 < argc) {
+			chunk_size = (float)std::atof(argv[++i]);
+			if (chunk_size <= 0.0f) {
+				usage(argv[0]);
+				return 1;
+			}
+		} else if (arg == "--chunk-budget" && i + 1 < argc) {
+			chunk_config.resident_budget = (std::size_t)std::atol(argv[++i]) << 20;
+		} else if (arg == "--chunk-dir" && i + 1 < argc) {
+			chunk_config.page_dir = argv[++i];
+		} else if (arg == "--adaptive") {
+			adaptive = true;
+		} else if (arg == "--frame-budget" && i + 1 < argc) {
+			adaptive = true;
+			quality_config.budget_ms = std::atof(argv[++i]);
+		} else if (arg == "--max-substeps" && i + 1 < argc) {
+			adaptive = true;
+			quality_config.max_substeps = std::atoi(argv[++i]);
+		} else if (arg == "--adaptive-boids") {
+			adaptive = true;
+			quality_config.scale_boids = true;
+		} else if (arg == "--publish" && i + 1 < argc) {
+			publish_name = argv[++i];
+		} else if (arg == "--record" && i + 1 < argc) {
+			record_target = argv[++i];
+		} else if (arg == "--record-format" && i + 1 < argc) {
+			if (not FrameExporter::parse_format(argv[++i], record_format)) {
+				usage(argv[0]);
+				return 1;
+			}
+		} else if (arg == "--record-frames" && i + 1 < argc) {
+			g.record_frames = std::atol(argv[++i]);
+		} else if (arg == "--analytics" && i + 1 < argc) {
+			analytics_path = argv[++i];
+		} else if (arg == "--analytics-format" && i + 1 < argc) {
+			if (not FlockAnalytics::parse_format(argv[++i], analytics_format)) {
+				usage(argv[0]);
+				return 1;
+			}
+		} else if (arg == "--analytics-every" && i + 1 < argc) {
+			analytics_every = std::atoi(argv[++i]);
+		} else if (arg == "--analytics-budget" && i + 1 < argc) {
+			analytics_budget = std::atof(argv[++i]);
+		} else {
+			usage(argv[0]);
+			return 1;
+		}
+	}
+
+	g.jobs.reset(new JobSystem(threads));
+	g.flock.reset(new Flock(num_boids, g.world_width, g.world_height));
+	g.flock->set_job_system(g.jobs.get());
+	g.flock->set_deterministic(deterministic);
+	g.flock->set_multirate(multirate);
+	g.camera = Camera((float)g.world_width, (float)g.world_height, WIDTH, HEIGHT);
+
+	if (chunk_size > 0.0f) {
+		chunk_config.chunk_size = chunk_size;
+		chunk_config.focus_margin = chunk_size;
+		g.world.reset(new ChunkedWorld(*g.flock, g.world_width, g.world_height, chunk_config));
+		if (not g.world->is_ok()) {
+			std::cerr << "cannot create the chunk page file in " << g.world->get_page_dir() << "\n";
+			return 1;
+		}
+	}
+
+	if (not analytics_path.empty()) {
+		g.analytics.reset(new FlockAnalytics(analytics_path, analytics_format, analytics_every));
+		if (not g.analytics->is_ok()) {
+			std::cerr << "cannot open analytics file: " << analytics_path << "\n";
+			return 1;
+		}
+		g.analytics->set_job_system(g.jobs.get());
+		g.analytics->set_max_overhead(analytics_budget / 100.0);
+		g.flock->set_analytics(g.analytics.get());
+	}
 
+	if (adaptive) {
+		// The chunked world already decides which boids are simulated
+		quality_config.scale_boids = quality_config.scale_boids && not g.world;
+		quality_config.max_boids = num_boids;
+		quality_config.min_boids = std::min(num_boids, 100);
+		g.quality.reset(new QualityController(quality_config));
+	}
 
-	int status;
+	if (not publish_name.empty()) {
+		g.publisher.reset(new StatePublisher(publish_name, (std::uint32_t)num_boids,
+				(float)g.world_width, (float)g.world_height));
+		if (not g.publisher->is_ok()) {
+			std::cerr << "cannot create shared memory: " << publish_name << "\n";
+			return 1;
+		}
+	}
 
 	if (SDL_Init(SDL_INIT_VIDEO | SDL_INIT_AUDIO | SDL_INIT_EVENTS | SDL_INIT_TIMER) != 0) {
 		return 1;
@@ -151,12 +565,51 @@ int main(int argc, char ** argv)
 		return 1;
 	}
 
+	create_layers();
+
+	if (not record_target.empty()) {
+		if (not create_frame_target()) {
+			return 1;
+		}
+		g.exporter.reset(new FrameExporter(record_target, record_format, WIDTH, HEIGHT));
+		if (not g.exporter->is_ok()) {
+			std::cerr << "cannot open recording target: " << record_target << "\n";
+			return 1;
+		}
+	}
+
+	// Frames are due every frame period (the budget when adaptive); events are
+	// handled while waiting for the next one, but never delay it
+	std::chrono::duration<double, std::milli> const frame_period(g.quality ? quality_config.budget_ms : 20.0);
+	auto next_frame = std::chrono::steady_clock::now();
+
 	bool end = false;
 	while (not end) {
 		SDL_Event event;
-		if (SDL_WaitEventTimeout(&event, 20)) {
+		auto const now = std::chrono::steady_clock::now();
+		int const wait_ms = (int)std::chrono::duration_cast<std::chrono::milliseconds>(next_frame - now).count();
+		if (wait_ms > 0 ? SDL_WaitEventTimeout(&event, wait_ms) : SDL_PollEvent(&event)) {
 			switch (event.type) {
+			case SDL_RENDER_TARGETS_RESET:
+			case SDL_RENDER_DEVICE_RESET:
+				if (event.type == SDL_RENDER_DEVICE_RESET && g.heatmap) {
+					SDL_DestroyTexture(g.heatmap);
+					g.heatmap = NULL;
+				}
+				// Like the cached layers: a lost frame is not exported, a lost texture is recreated
+				if (g.frame_target) {
+					if (event.type == SDL_RENDER_DEVICE_RESET) {
+						if (not create_frame_target()) {
+							std::cerr << "cannot recreate the recording target\n";
+							return 1;
+						}
+					}
+					g.frame_pending = false;
+				}
+				g.layers->handle_event(event);
+				break;
 			case SDL_WINDOWEVENT:
+				g.layers->handle_event(event);
 				switch (event.window.event) {
 					case SDL_WINDOWEVENT_CLOSE:
 						end = true;
@@ -172,23 +625,112 @@ int main(int argc, char ** argv)
 				if (event.key.keysym.sym == SDLK_ESCAPE) {
 					end = true;
 				}
+				handle_camera_event(event);
 				break;
 			case SDL_KEYUP:
 				break;
+			case SDL_MOUSEWHEEL:
+			case SDL_MOUSEMOTION:
+				handle_camera_event(event);
+				break;
 			}
 		} else {
-			// Got time out or error
-			char const * e = SDL_GetError();
+			// Got time out (or no event pending) or error
+			char const * e = wait_ms > 0 ? SDL_GetError() : NULL;
 			if (e != NULL) {
 				if (strlen(e) != 0) {
 					// Got error
 					return 1;
 				}
 			}
+			if (std::chrono::steady_clock::now() < next_frame) {
+				continue; // Woke up early (sub-millisecond remainder)
+			}
+
+			do_frame();
+
+			// After an overrun, start the next period now instead of catching up
+			next_frame += std::chrono::duration_cast<std::chrono::steady_clock::duration>(frame_period);
+			if (next_frame < std::chrono::steady_clock::now()) {
+				next_frame = std::chrono::steady_clock::now();
+			}
+
+			if (g.record_frames == 0) {
+				end = true;
+			}
+		}
+	}
 
-			do_update();
-			do_render();
+	if (g.exporter) {
+		// Read back the last frame, then flush queued frames before tearing down the renderer
+		if (g.frame_pending) {
+			SDL_SetRenderTarget(g.renderer, g.frame_target);
+			export_frame();
+			SDL_SetRenderTarget(g.renderer, NULL);
 		}
+		bool const recorded = g.exporter->finish();
+		FrameExporter::Stats stats = g.exporter->get_stats();
+		g.exporter.reset();
+		std::cerr << "recorded " << stats.submitted << " frames ("
+		          << stats.dropped << " dropped)\n";
+		if (not recorded) {
+			std::cerr << "recording failed: could not write every frame or the encoder exited with an error\n";
+		}
+		SDL_DestroyTexture(g.frame_target);
+	}
+
+	if (g.analytics) {
+		std::cerr << "analytics overhead: " << 100.0 * g.analytics->overhead() << "% of update time ("
+		          << g.analytics->get_postponed() << " samples postponed)\n";
+		g.flock->set_analytics(nullptr);
+		g.analytics.reset();
+	}
+
+	if (g.publisher) {
+		StatePublisher::Stats published = g.publisher->get_stats();
+		std::cerr << "published " << published.published << " frames ("
+		          << published.truncated << " truncated)\n";
+		g.publisher.reset();
+	}
+
+	if (g.quality) {
+		QualityController::State const & q = g.quality->get_state();
+		std::cerr << "quality: " << g.quality->get_changes() << " changes, ended at "
+		          << QualityController::lod_name(q.lod) << ", " << q.substeps << " substeps";
+		if (quality_config.scale_boids) {
+			std::cerr << ", " << q.active_boids << " active boids";
+		}
+		std::cerr << " (" << g.quality->get_frame_ms() << " ms per frame)\n";
+	}
+
+	if (g.jobs->get_thread_count() > 1) {
+		std::vector<JobSystem::WorkerStats> stats = g.jobs->get_stats();
+		for (std::size_t i = 0; i < stats.size(); ++i) {
+			std::cerr << "worker " << i << ": " << stats[i].executed << " tasks, "
+			          << stats[i].steals << " steals, " << stats[i].failed_steals << " failed steals, "
+			          << stats[i].idle_seconds << " s idle\n";
+		}
+	}
+	if (g.flock->is_multirate()) {
+		std::cerr << "multirate: rules evaluated for " << 100.0 * g.flock->get_evaluated_fraction()
+		          << "% of boid updates\n";
+	}
+	if (g.world) {
+		ChunkedWorld::Stats chunks = g.world->get_stats();
+		std::cerr << "chunks: " << chunks.active_chunks << " active (" << chunks.active_boids << " boids), "
+		          << chunks.dormant_chunks << " dormant (" << chunks.dormant_boids << "), "
+		          << chunks.evicted_chunks << " evicted (" << chunks.evicted_boids << "), "
+		          << chunks.page_outs << " page-outs, " << chunks.page_ins << " page-ins\n";
+		g.world.reset();
+	}
+	g.flock.reset();
+	g.jobs.reset();
+
+	LayerCache::Stats layer_stats = g.layers->get_stats();
+	std::cerr << "layers: " << layer_stats.repaints << " repaints, " << layer_stats.copies << " cached copies\n";
+	g.layers.reset();
+	if (g.heatmap) {
+		SDL_DestroyTexture(g.heatmap);
 	}
 
 	SDL_DestroyRenderer(g.renderer);
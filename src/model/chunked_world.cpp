@@ -0,0 +1,351 @@
+#include "chunked_world.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+// --- Page File ---
+
+BoidPageFile::~BoidPageFile() {
+    if (this->map) {
+        munmap(this->map, this->capacity * sizeof(Boid));
+    }
+    if (this->fd >= 0) {
+        close(this->fd);
+    }
+}
+
+bool BoidPageFile::open(std::string const & directory) {
+    std::string path = directory + "/flock-pages-XXXXXX";
+    std::vector<char> name(path.begin(), path.end());
+    name.push_back('\0');
+    this->fd = mkstemp(name.data());
+    if (this->fd < 0) {
+        return false;
+    }
+    // The open descriptor keeps the data; the name is not needed
+    unlink(name.data());
+    return true;
+}
+
+bool BoidPageFile::grow(std::size_t min_boids) {
+    std::size_t const old_capacity = this->capacity;
+    std::size_t new_capacity = std::max(old_capacity * 2, old_capacity + min_boids);
+    new_capacity = std::max(new_capacity, (std::size_t)4096);
+
+    if (ftruncate(this->fd, (off_t)(new_capacity * sizeof(Boid))) != 0) {
+        return false;
+    }
+    void* fresh = mmap(nullptr, new_capacity * sizeof(Boid), PROT_READ | PROT_WRITE, MAP_SHARED, this->fd, 0);
+    if (fresh == MAP_FAILED) {
+        return false;
+    }
+    if (this->map) {
+        munmap(this->map, old_capacity * sizeof(Boid));
+    }
+    this->map = static_cast<Boid*>(fresh);
+    this->capacity = new_capacity;
+    this->release((long long)old_capacity, new_capacity - old_capacity);
+    return true;
+}
+
+void BoidPageFile::release(long long offset, std::size_t count) {
+    // Keep the list sorted and merge with the neighbors so large slots come back
+    auto it = std::lower_bound(this->free_list.begin(), this->free_list.end(), offset,
+                               [](Extent const & e, long long o) { return e.offset < o; });
+    it = this->free_list.insert(it, Extent{offset, count});
+    if (it + 1 != this->free_list.end() && it->offset + (long long)it->count == (it + 1)->offset) {
+        it->count += (it + 1)->count;
+        this->free_list.erase(it + 1);
+    }
+    if (it != this->free_list.begin() && (it - 1)->offset + (long long)(it - 1)->count == it->offset) {
+        (it - 1)->count += it->count;
+        this->free_list.erase(it);
+    }
+}
+
+long long BoidPageFile::store(const Boid* boids, std::size_t count) {
+    if (this->fd < 0 || count == 0) {
+        return -1;
+    }
+
+    for (int attempt = 0; attempt < 2; ++attempt) {
+        for (std::size_t k = 0; k < this->free_list.size(); ++k) {
+            Extent& e = this->free_list[k];
+            if (e.count < count) {
+                continue;
+            }
+            long long const offset = e.offset;
+            e.offset += count;
+            e.count -= count;
+            if (e.count == 0) {
+                this->free_list.erase(this->free_list.begin() + k);
+            }
+
+            Boid* dst = this->map + offset;
+            std::copy(boids, boids + count, dst);
+
+            // Drop the whole pages we just wrote from our working set; the data
+            // stays in the file (and the page cache) until it is loaded again
+            long const page = sysconf(_SC_PAGESIZE);
+            std::uintptr_t begin = (std::uintptr_t)dst;
+            std::uintptr_t end = (std::uintptr_t)(dst + count);
+            begin = (begin + page - 1) / page * page;
+            end = end / page * page;
+            if (end > begin) {
+                madvise((void*)begin, end - begin, MADV_DONTNEED);
+            }
+            return offset;
+        }
+        if (!this->grow(count)) {
+            return -1;
+        }
+    }
+    return -1;
+}
+
+void BoidPageFile::load(long long offset, std::size_t count, std::vector<Boid>& out) {
+    if (count == 0) {
+        return;
+    }
+    out.insert(out.end(), this->map + offset, this->map + offset + count);
+    this->release(offset, count);
+}
+
+// --- Chunked World ---
+
+ChunkedWorld::ChunkedWorld(Flock& flock, int width, int height, Config const & config)
+    : flock(flock), width(width), height(height), config(config) {
+
+    this->config.chunk_size = std::max(this->config.chunk_size, 1.0f);
+    this->cols = std::max(1, (int)std::ceil(width / this->config.chunk_size));
+    this->rows = std::max(1, (int)std::ceil(height / this->config.chunk_size));
+    this->chunks.resize((std::size_t)this->cols * this->rows);
+
+    if (this->config.page_dir.empty()) {
+        // Not /tmp or $TMPDIR: those are commonly tmpfs, where paging out frees no RAM
+        this->config.page_dir = "/var/tmp";
+    }
+    this->pages.open(this->config.page_dir);
+
+    // Everything is in focus until the caller narrows it
+    this->set_focus(0.0f, 0.0f, (float)width, (float)height);
+    for (Chunk& chunk : this->chunks) {
+        chunk.state = State::ACTIVE;
+    }
+}
+
+void ChunkedWorld::set_focus(float x0, float y0, float x1, float y1) {
+    float const m = this->config.focus_margin;
+    this->focus[0] = x0 - m;
+    this->focus[1] = y0 - m;
+    this->focus[2] = x1 + m;
+    this->focus[3] = y1 + m;
+}
+
+int ChunkedWorld::chunk_of(const Vec2& p) const {
+    int cx = (int)std::floor(p.x / this->config.chunk_size);
+    int cy = (int)std::floor(p.y / this->config.chunk_size);
+    cx = std::min(std::max(cx, 0), this->cols - 1);
+    cy = std::min(std::max(cy, 0), this->rows - 1);
+    return cy * this->cols + cx;
+}
+
+bool ChunkedWorld::wants_active(int c, std::size_t population) const {
+    float const size = this->config.chunk_size;
+    float const x0 = (c % this->cols) * size;
+    float const y0 = (c / this->cols) * size;
+    bool const in_focus = x0 < this->focus[2] && x0 + size > this->focus[0]
+                       && y0 < this->focus[3] && y0 + size > this->focus[1];
+    bool const dense = this->config.dense_threshold > 0
+                    && population >= (std::size_t)this->config.dense_threshold;
+    return in_focus || dense;
+}
+
+void ChunkedWorld::page_in(int c) {
+    Chunk& chunk = this->chunks[c];
+    if (chunk.state != State::EVICTED) {
+        return;
+    }
+    this->pages.load(chunk.page_offset, chunk.page_count, chunk.boids);
+    chunk.page_offset = -1;
+    chunk.page_count = 0;
+    chunk.state = State::DORMANT;
+    this->page_ins++;
+}
+
+void ChunkedWorld::classify() {
+    // Population of each active chunk, from the flock's current positions
+    std::vector<std::size_t> population(this->chunks.size(), 0);
+    for (const Boid& b : this->flock.get_boids()) {
+        population[this->chunk_of(b.position)]++;
+    }
+
+    this->scratch.clear();
+    for (int c = 0; c < (int)this->chunks.size(); ++c) {
+        Chunk& chunk = this->chunks[c];
+        std::size_t count = population[c];
+        if (chunk.state == State::DORMANT) {
+            count = chunk.boids.size();
+        } else if (chunk.state == State::EVICTED) {
+            count = chunk.page_count;
+        }
+
+        bool const active = this->wants_active(c, count);
+        if (active && chunk.state != State::ACTIVE) {
+            this->page_in(c);
+            this->scratch.insert(this->scratch.end(), chunk.boids.begin(), chunk.boids.end());
+            std::vector<Boid>().swap(chunk.boids);
+            chunk.state = State::ACTIVE;
+        } else if (!active && chunk.state == State::ACTIVE) {
+            // Its boids leave the flock in route_outgoing()
+            chunk.state = State::DORMANT;
+        }
+        if (chunk.state == State::ACTIVE) {
+            chunk.last_active = this->step;
+        }
+    }
+    this->flock.add_boids(this->scratch.data(), this->scratch.size());
+}
+
+void ChunkedWorld::store_dormant(const Boid& b) {
+    Chunk& chunk = this->chunks[this->chunk_of(b.position)];
+    this->page_in(this->chunk_of(b.position));
+    chunk.boids.push_back(b);
+}
+
+void ChunkedWorld::route_outgoing() {
+    // Boids of chunks that just went dormant, and boids that flew out of the active area
+    this->scratch.clear();
+    this->flock.extract_boids([this](const Boid& b) {
+        return this->chunks[this->chunk_of(b.position)].state != State::ACTIVE;
+    }, this->scratch);
+    for (const Boid& b : this->scratch) {
+        this->store_dormant(b);
+    }
+}
+
+void ChunkedWorld::advance_dormant(float dt) {
+    this->pending_dt += dt;
+    if (this->config.coarse_interval <= 0) {
+        this->pending_dt = 0.0f; // Frozen
+        return;
+    }
+    if (this->step % (std::uint64_t)this->config.coarse_interval != 0) {
+        return;
+    }
+    float const step_dt = this->pending_dt;
+    this->pending_dt = 0.0f;
+
+    // Ballistic advance: no rules, same wrap-around as the flock
+    float const w = (float)this->width;
+    float const h = (float)this->height;
+    std::vector<Boid> movers;
+    std::vector<Boid> arrivals;
+    for (int c = 0; c < (int)this->chunks.size(); ++c) {
+        Chunk& chunk = this->chunks[c];
+        if (chunk.state != State::DORMANT) {
+            continue;
+        }
+        std::size_t kept = 0;
+        for (std::size_t i = 0; i < chunk.boids.size(); ++i) {
+            Boid b = chunk.boids[i];
+            b.position += b.velocity * step_dt;
+            b.position.x -= std::floor(b.position.x / w) * w;
+            b.position.y -= std::floor(b.position.y / h) * h;
+            if (this->chunk_of(b.position) == c) {
+                chunk.boids[kept++] = b;
+            } else {
+                movers.push_back(b);
+            }
+        }
+        chunk.boids.resize(kept);
+    }
+
+    // Move boids that crossed a chunk border once every chunk has been advanced
+    for (const Boid& b : movers) {
+        if (this->chunks[this->chunk_of(b.position)].state == State::ACTIVE) {
+            arrivals.push_back(b);
+        } else {
+            this->store_dormant(b);
+        }
+    }
+    this->flock.add_boids(arrivals.data(), arrivals.size());
+}
+
+void ChunkedWorld::enforce_budget() {
+    std::size_t resident = 0;
+    std::vector<int> candidates;
+    for (int c = 0; c < (int)this->chunks.size(); ++c) {
+        Chunk const & chunk = this->chunks[c];
+        if (chunk.state == State::DORMANT) {
+            resident += chunk.boids.capacity() * sizeof(Boid);
+            if (!chunk.boids.empty()) {
+                candidates.push_back(c);
+            }
+        }
+    }
+    if (resident <= this->config.resident_budget || !this->pages.is_open()) {
+        return;
+    }
+
+    // Least recently active first
+    std::sort(candidates.begin(), candidates.end(), [this](int a, int b) {
+        return this->chunks[a].last_active < this->chunks[b].last_active;
+    });
+    for (int c : candidates) {
+        if (resident <= this->config.resident_budget) {
+            break;
+        }
+        Chunk& chunk = this->chunks[c];
+        long long offset = this->pages.store(chunk.boids.data(), chunk.boids.size());
+        if (offset < 0) {
+            return; // File cannot grow; stay over budget
+        }
+        resident -= chunk.boids.capacity() * sizeof(Boid);
+        chunk.page_offset = offset;
+        chunk.page_count = chunk.boids.size();
+        std::vector<Boid>().swap(chunk.boids);
+        chunk.state = State::EVICTED;
+        this->page_outs++;
+    }
+}
+
+void ChunkedWorld::update(float dt) {
+    this->step++;
+
+    this->classify();
+    this->route_outgoing();
+
+    this->flock.update(dt, this->width, this->height);
+
+    this->advance_dormant(dt);
+    this->enforce_budget();
+}
+
+ChunkedWorld::Stats ChunkedWorld::get_stats() const {
+    Stats stats;
+    for (Chunk const & chunk : this->chunks) {
+        switch (chunk.state) {
+            case State::ACTIVE:
+                stats.active_chunks++;
+                break;
+            case State::DORMANT:
+                stats.dormant_chunks++;
+                stats.dormant_boids += chunk.boids.size();
+                stats.resident_bytes += chunk.boids.capacity() * sizeof(Boid);
+                break;
+            case State::EVICTED:
+                stats.evicted_chunks++;
+                stats.evicted_boids += chunk.page_count;
+                break;
+        }
+    }
+    stats.active_boids = this->flock.get_boids().size();
+    stats.file_bytes = this->pages.get_file_bytes();
+    stats.page_ins = this->page_ins;
+    stats.page_outs = this->page_outs;
+    return stats;
+}
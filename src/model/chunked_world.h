@@ -0,0 +1,160 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "boid.h"
+#include "flock.h"
+
+/**
+ * @brief Memory-mapped file that holds the boids of evicted chunks.
+ * * The file is created with a unique name in a temporary directory and
+ * unlinked right away, so it is never visible to other programs and its
+ * space is returned when the process exits, even after a crash.
+ * * Space is handed out in whole-boid slots (first fit over a free list,
+ * growing the file when nothing fits). After a chunk is written its pages
+ * are dropped from the process with madvise, so they count against the
+ * page cache rather than the simulation's resident memory.
+ */
+class BoidPageFile {
+public:
+    BoidPageFile() {}
+    ~BoidPageFile();
+
+    BoidPageFile(BoidPageFile const &) = delete;
+    BoidPageFile& operator=(BoidPageFile const &) = delete;
+
+    /**
+     * @brief Creates the anonymous backing file in `directory`. Returns false on error.
+     */
+    bool open(std::string const & directory);
+    bool is_open() const { return this->fd >= 0; }
+
+    /**
+     * @brief Writes `count` boids to a newly allocated slot.
+     * @return The slot offset (in boids), or -1 if the file could not grow.
+     */
+    long long store(const Boid* boids, std::size_t count);
+
+    /**
+     * @brief Reads a slot back into `out` (appending) and frees it.
+     */
+    void load(long long offset, std::size_t count, std::vector<Boid>& out);
+
+    std::size_t get_file_bytes() const { return this->capacity * sizeof(Boid); }
+
+private:
+    bool grow(std::size_t min_boids);
+    void release(long long offset, std::size_t count);
+
+    int fd = -1;
+    Boid* map = nullptr;
+    std::size_t capacity = 0; // in boids
+
+    struct Extent {
+        long long offset;
+        std::size_t count;
+    };
+    std::vector<Extent> free_list; // sorted by offset, coalesced
+};
+
+/**
+ * @brief Splits a large world into square chunks and only simulates the active ones.
+ * * Chunks overlapping the focus rectangle (usually the camera view plus a
+ * margin) or holding at least `dense_threshold` boids are active: their boids
+ * live in the Flock and get the full update. Other chunks are dormant and keep
+ * their boids on the side, advanced ballistically (position += velocity * dt)
+ * every `coarse_interval` steps, or not at all if `coarse_interval` is 0.
+ * When dormant chunks exceed the resident budget, the least recently active
+ * ones are evicted to the page file; evicted chunks are frozen until the
+ * focus or a migrating boid pages them back in.
+ */
+class ChunkedWorld {
+public:
+    struct Config {
+        float chunk_size = 2048.0f;
+        std::size_t resident_budget = 64u << 20; // Bytes of dormant boids kept in RAM
+        int coarse_interval = 8;                  // Steps between dormant advances (0 = frozen)
+        int dense_threshold = 256;                // Boids that keep a chunk active on their own
+        float focus_margin = 0.0f;                // Extra world units around the focus rectangle
+        std::string page_dir;                     // Where the page file is created ("" = /var/tmp)
+    };
+
+    struct Stats {
+        int active_chunks = 0;
+        int dormant_chunks = 0;  // Resident, not simulated in full
+        int evicted_chunks = 0;  // In the page file
+        std::size_t active_boids = 0;
+        std::size_t dormant_boids = 0;
+        std::size_t evicted_boids = 0;
+        std::size_t resident_bytes = 0; // Dormant boids held in RAM
+        std::size_t file_bytes = 0;
+        std::uint64_t page_ins = 0;
+        std::uint64_t page_outs = 0;
+    };
+
+    /**
+     * @brief The page file must live on a disk-backed file system for
+     * eviction to free memory. /tmp (and often $TMPDIR) is tmpfs on many
+     * systems, where evicted pages stay in RAM, so the default is /var/tmp.
+     * * Starts with every chunk active, so all boids stay in the flock
+     * until the first update() deactivates the chunks outside the focus and
+     * moves their boids into chunk storage. The flock must outlive the world.
+     */
+    ChunkedWorld(Flock& flock, int width, int height, Config const & config);
+
+    bool is_ok() const { return this->pages.is_open(); }
+    std::string const & get_page_dir() const { return this->config.page_dir; }
+
+    /**
+     * @brief Sets the world rectangle that must be simulated in full (e.g. the camera view).
+     * Takes effect at the next update().
+     */
+    void set_focus(float x0, float y0, float x1, float y1);
+
+    /**
+     * @brief One simulation step: activates/deactivates chunks, steps the flock,
+     * advances dormant chunks and moves boids that crossed chunk borders.
+     */
+    void update(float dt);
+
+    Stats get_stats() const;
+
+private:
+    enum class State { ACTIVE, DORMANT, EVICTED };
+
+    struct Chunk {
+        State state = State::DORMANT;
+        std::vector<Boid> boids;     // Dormant boids (empty when active or evicted)
+        long long page_offset = -1;  // Slot in the page file when evicted
+        std::size_t page_count = 0;
+        std::uint64_t last_active = 0; // Step the chunk was last active (LRU key)
+    };
+
+    int chunk_of(const Vec2& p) const;
+    bool wants_active(int c, std::size_t population) const;
+    void page_in(int c);
+    void store_dormant(const Boid& b);
+    void classify();
+    void advance_dormant(float dt);
+    void route_outgoing();
+    void enforce_budget();
+
+    Flock& flock;
+    int width;
+    int height;
+    Config config;
+
+    int cols = 1;
+    int rows = 1;
+    std::vector<Chunk> chunks;
+    BoidPageFile pages;
+
+    float focus[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+    std::uint64_t step = 0;
+    float pending_dt = 0.0f; // Time dormant chunks have not been advanced by yet
+    std::uint64_t page_ins = 0;
+    std::uint64_t page_outs = 0;
+    std::vector<Boid> scratch;
+};
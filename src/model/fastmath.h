@@ -0,0 +1,114 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include "vec2.h"
+
+/**
+ * @brief Approximate vector kernels built on a single reciprocal square root.
+ * * The exact path (Vec2::magnitude, Vec2::normalize) takes one sqrt and one
+ * divide per call, and clamping a vector takes two of each. Every kernel here
+ * derives what it needs from one rsqrt estimate of |v|^2, optionally refined
+ * with Newton-Raphson steps (each step roughly doubles the correct bits).
+ * * Enabled in the simulation with `./configure --enable-fast-math`.
+ */
+namespace fastmath {
+
+    // Newton steps used when the caller does not ask for a specific count.
+    // Relative error is ~3.4e-2 raw, ~1.75e-3 after one step and ~4.8e-6 after
+    // two (checked by tools/fastmath_accuracy.cxx); one step is plenty for the
+    // speed and force limits and the separation weights.
+    int const DEFAULT_NEWTON_STEPS = 1;
+
+    /**
+     * @brief Approximates 1 / sqrt(x) for x > 0.
+     * @param x The input value (must be positive and finite).
+     * @param newton_steps Number of Newton-Raphson refinements (0 = raw estimate).
+     */
+    inline float rsqrt(float x, int newton_steps = DEFAULT_NEWTON_STEPS) {
+        std::uint32_t i;
+        std::memcpy(&i, &x, sizeof(i));
+        i = 0x5f375a86u - (i >> 1);
+        float y;
+        std::memcpy(&y, &i, sizeof(y));
+
+        float const half_x = 0.5f * x;
+        for (int k = 0; k < newton_steps; ++k) {
+            y = y * (1.5f - half_x * y * y);
+        }
+        return y;
+    }
+
+    // --- Single-vector kernels ---
+
+    /**
+     * @brief Unit vector in the direction of v, or zero for near-zero vectors.
+     */
+    inline Vec2 normalize(const Vec2& v, int newton_steps = DEFAULT_NEWTON_STEPS) {
+        float mag_sq = v.magnitude_sq();
+        if (mag_sq > 1e-12f) { // Same cut-off as Vec2::normalize (|v| > 1e-6)
+            return v * rsqrt(mag_sq, newton_steps);
+        }
+        return Vec2{0.0f, 0.0f};
+    }
+
+    /**
+     * @brief Scales v down to max_mag if it is longer, otherwise returns it unchanged.
+     * Only one rsqrt is evaluated, and only when the clamp actually applies.
+     */
+    inline Vec2 clamp_magnitude(const Vec2& v, float max_mag, int newton_steps = DEFAULT_NEWTON_STEPS) {
+        float mag_sq = v.magnitude_sq();
+        if (mag_sq > max_mag * max_mag) {
+            return v * (max_mag * rsqrt(mag_sq, newton_steps));
+        }
+        return v;
+    }
+
+    /**
+     * @brief Returns d / |d|^2, the inverse-distance weighting used by the
+     * separation rule, or zero when d is zero.
+     * * Computed as d * r * r with r = rsqrt(|d|^2), so there is no divide.
+     */
+    inline Vec2 inverse_square_weight(const Vec2& d, int newton_steps = DEFAULT_NEWTON_STEPS) {
+        float mag_sq = d.magnitude_sq();
+        if (mag_sq > 0.0f) {
+            float r = rsqrt(mag_sq, newton_steps);
+            return d * (r * r);
+        }
+        return Vec2{0.0f, 0.0f};
+    }
+
+    // --- Batched kernels (in place over arrays) ---
+    // Elements are `stride` bytes apart, so besides plain Vec2 arrays they also
+    // run over one member of an array of structs, e.g. the velocities of a
+    // boid array with stride sizeof(Boid). Each element gets the same result
+    // as the single-vector kernel.
+
+    inline void normalize(Vec2* v, std::size_t n, std::size_t stride = sizeof(Vec2),
+                          int newton_steps = DEFAULT_NEWTON_STEPS) {
+        char* p = reinterpret_cast<char*>(v);
+        for (std::size_t i = 0; i < n; ++i, p += stride) {
+            Vec2& e = *reinterpret_cast<Vec2*>(p);
+            e = normalize(e, newton_steps);
+        }
+    }
+
+    inline void clamp_magnitude(Vec2* v, std::size_t n, float max_mag, std::size_t stride = sizeof(Vec2),
+                                int newton_steps = DEFAULT_NEWTON_STEPS) {
+        char* p = reinterpret_cast<char*>(v);
+        for (std::size_t i = 0; i < n; ++i, p += stride) {
+            Vec2& e = *reinterpret_cast<Vec2*>(p);
+            e = clamp_magnitude(e, max_mag, newton_steps);
+        }
+    }
+
+    inline void inverse_square_weight(Vec2* d, std::size_t n, std::size_t stride = sizeof(Vec2),
+                                      int newton_steps = DEFAULT_NEWTON_STEPS) {
+        char* p = reinterpret_cast<char*>(d);
+        for (std::size_t i = 0; i < n; ++i, p += stride) {
+            Vec2& e = *reinterpret_cast<Vec2*>(p);
+            e = inverse_square_weight(e, newton_steps);
+        }
+    }
+}
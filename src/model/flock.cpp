@@ -1,6 +1,15 @@
 #include "flock.h"
+#include "flock_analytics.h"
+#include "../utility/job_system.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <cmath>
 
+#ifdef FLOCK_FAST_MATH
+#include "fastmath.h"
+#endif
+
 // --- Helper for Random Number Generation (Used in constructor) ---
 float random_float(std::default_random_engine& engine, std::uniform_real_distribution<float>& dist, float min, float max) {
     dist.param(std::uniform_real_distribution<float>::param_type(min, max));
@@ -8,10 +17,12 @@ float random_float(std::default_random_engine& engine, std::uniform_real_distrib
 }
 
 // --- Constructor (Initialization) ---
-Flock::Flock(int num_boids, int width, int height) {
+Flock::Flock(int num_boids, int width, int height)
+    : Flock(num_boids, width, height, std::random_device()()) {}
+
+Flock::Flock(int num_boids, int width, int height, unsigned int seed) {
     // Seed the random engine
-    std::random_device rd;
-    engine.seed(rd());
+    engine.seed(seed);
 
     // Initialize boids at random positions with small random velocities
     for (int i = 0; i < num_boids; ++i) {
@@ -19,26 +30,95 @@ Flock::Flock(int num_boids, int width, int height) {
                     random_float(engine, rand_dist, 0.0f, (float)height)};
         
         // Initial velocity should be small
-        Vec2 vel = {random_float(engine, rand_dist, -MAX_SPEED, MAX_SPEED) * 0.1f, 
-                    random_float(engine, rand_dist, -MAX_SPEED, MAX_SPEED) * 0.1f};
+        Vec2 vel = {random_float(engine, rand_dist, -this->max_speed, this->max_speed) * 0.1f, 
+                    random_float(engine, rand_dist, -this->max_speed, this->max_speed) * 0.1f};
         
         boids.emplace_back(pos, vel);
     }
+
+    this->grid_width = width;
+    this->grid_height = height;
+    this->grid.build(this->boids, NEIGHBOR_RADIUS, width, height);
 }
 
-// --- 1. Rule Implementations (Stubs) ---
+// --- Adding and Removing Boids, Parameters ---
 
-// Rule 1: Cohesion (Move towards average position)
-Vec2 Flock::rule_cohesion(const Boid& b) const {
-    Vec2 center_of_mass = {0.0f, 0.0f};
-    int count = 0;
+int Flock::extract_boids(const std::function<bool(const Boid&)>& pred, std::vector<Boid>& out) {
+    // Step levels move along with the boids that stay
+    bool const remap = this->step_state.size() == this->boids.size();
+    std::size_t kept = 0;
+    for (std::size_t i = 0; i < this->boids.size(); ++i) {
+        if (pred(this->boids[i])) {
+            out.push_back(this->boids[i]);
+        } else {
+            this->boids[kept] = this->boids[i];
+            if (remap) {
+                this->step_state[kept] = this->step_state[i];
+            }
+            kept++;
+        }
+    }
+    int removed = (int)(this->boids.size() - kept);
+    if (removed > 0) {
+        this->boids.resize(kept);
+        if (remap) {
+            this->step_state.resize(kept);
+        }
+        this->on_boids_changed();
+    }
+    return removed;
+}
 
-    for (const Boid& other : this->boids) {
-        if (&other != &b) { // Exclude itself
-            center_of_mass += other.position;
-            count++;
+void Flock::add_boids(const Boid* first, std::size_t count) {
+    if (count == 0) {
+        return;
+    }
+    if (this->multirate && this->step_state.size() == this->boids.size()) {
+        // Newcomers start at level 0; everyone else keeps their level
+        for (const Boid* b = first; b != first + count; ++b) {
+            StepState st;
+            st.last_acceleration = b->acceleration;
+            this->step_state.push_back(st);
         }
     }
+    this->boids.insert(this->boids.end(), first, first + count);
+    this->on_boids_changed();
+}
+
+Flock::Params Flock::get_params() const {
+    Params p;
+    p.cohesion_weight = this->cohesion_weight;
+    p.separation_weight = this->separation_weight;
+    p.separation_radius = this->separation_radius;
+    p.alignment_weight = this->alignment_weight;
+    p.max_speed = this->max_speed;
+    p.max_force = this->max_force;
+    return p;
+}
+
+void Flock::set_params(const Params& params) {
+    this->cohesion_weight = params.cohesion_weight;
+    this->separation_weight = params.separation_weight;
+    this->separation_radius = params.separation_radius;
+    this->alignment_weight = params.alignment_weight;
+    this->max_speed = params.max_speed;
+    this->max_force = params.max_force;
+    // Step levels were derived from the old values
+    this->step_state.clear();
+}
+
+void Flock::on_boids_changed() {
+    // Indices shifted: the grid is stale (step levels were moved by the caller)
+    this->grid.build(this->boids, NEIGHBOR_RADIUS, this->grid_width, this->grid_height);
+}
+
+// --- 1. Rule Implementations (Stubs) ---
+
+// Rule 1: Cohesion (Move towards average position)
+Vec2 Flock::rule_cohesion(const Boid& b, const StateSums& sums) const {
+    // Sum over all other boids = sum over the flock minus itself
+    Vec2 center_of_mass = sums.position - b.position;
+    int count = (int)this->boids.size() - 1;
     
     if (count > 0) {
         center_of_mass /= (float)count;
@@ -48,14 +128,17 @@ Vec2 Flock::rule_cohesion(const Boid& b) const {
     return {0.0f, 0.0f};
 }
 
-Vec2 Flock::rule_separation(const Boid& b) const {
+Vec2 Flock::rule_separation(const Boid& b, int* neighbors) const {
     Vec2 steering_vector = {0.0f, 0.0f};
     int count = 0;
 
-    // Iterate over all other boids in the flock
-    for (const Boid& other : boids) {
+    // Iterate over the boids in the grid cells around this one. The grid holds
+    // the positions from the start of the step, and its visiting order is fixed
+    // (cells row by row, ascending index within a cell).
+    this->grid.for_each_near(b.position, this->separation_radius, [&](int j) {
+        const Boid& other = this->boids[j];
         if (&other == &b) {
-            continue; // Skip the boid itself
+            return; // Skip the boid itself
         }
 
         // 1. Calculate the squared distance between the two boids
@@ -63,7 +146,7 @@ Vec2 Flock::rule_separation(const Boid& b) const {
         float dist_sq = distance_sq(b.position, other.position);
 
         // 2. Check if the distance is within the repulsion radius
-        if (dist_sq < SEPARATION_WEIGHT * SEPARATION_WEIGHT) {
+        if (dist_sq < this->separation_radius * this->separation_radius) {
             // Found a "close boid"
 
             // 3. Calculate the repulsion vector (B.position - B'.position)
@@ -76,32 +159,33 @@ Vec2 Flock::rule_separation(const Boid& b) const {
             // (1.0f / dist_sq) makes the force much stronger when dist is small.
             if (dist_sq > 0.0f) {
                  // Weight = 1 / (distance^2)
+#ifdef FLOCK_FAST_MATH
+                steering_vector += fastmath::inverse_square_weight(difference);
+#else
                 difference = difference / dist_sq;
                 steering_vector += difference;
+#endif
                 count++;
             }
         }
-    }
+    });
 
     // 5. Calculate the average steering force (Optional: just returning the sum works too)
     // If the count is high, we usually divide by count to average the forces, 
     // or just return the accumulated sum. Returning the sum often leads to better separation.
     
+    if (neighbors) {
+        *neighbors = count;
+    }
+
     // The accumulated steering_vector represents the total repulsive force/acceleration.
     return steering_vector;
 }
 // Rule 3: Alignment (Match average velocity)
-Vec2 Flock::rule_alignment(const Boid& b) const {
-    // TODO: Calculate average velocity v of all neighbors (initially, all boids)
-    Vec2 average_velocity = {0.0f, 0.0f};
-    int count = 0;
-
-    for (const Boid& other : this->boids) {
-        if (&other != &b) { // Exclude itself
-            average_velocity += other.velocity;
-            count++;
-        }
-    }
+Vec2 Flock::rule_alignment(const Boid& b, const StateSums& sums) const {
+    // Average velocity v of all other boids, from the flock-wide sum
+    Vec2 average_velocity = sums.velocity - b.velocity;
+    int count = (int)this->boids.size() - 1;
 
     if (count > 0) {
         average_velocity /= (float)count;
@@ -113,10 +197,32 @@ Vec2 Flock::rule_alignment(const Boid& b) const {
 
 // --- 2. Utility Implementations ---
 
-void Flock::limit_velocity(Boid& b) {
-    if (b.velocity.magnitude() > MAX_SPEED) {
-        b.velocity = b.velocity.normalize() * MAX_SPEED;
+// Scales v down to max_mag if it is longer (approximate with FLOCK_FAST_MATH)
+static Vec2 limit_magnitude(const Vec2& v, float max_mag) {
+#ifdef FLOCK_FAST_MATH
+    return fastmath::clamp_magnitude(v, max_mag);
+#else
+    // Compare squared magnitudes so the sqrt is only taken when clamping
+    float mag_sq = v.magnitude_sq();
+    if (mag_sq > max_mag * max_mag) {
+        return v * (max_mag / std::sqrt(mag_sq));
     }
+    return v;
+#endif
+}
+
+void Flock::limit_magnitudes(Vec2 Boid::* field, float max_mag, int begin, int end) {
+#ifdef FLOCK_FAST_MATH
+    // One batched call over the field, striding over the boid array
+    if (begin < end) {
+        fastmath::clamp_magnitude(&(this->boids[begin].*field), end - begin, max_mag, sizeof(Boid));
+    }
+#else
+    for (int i = begin; i < end; ++i) {
+        Vec2& v = this->boids[i].*field;
+        v = limit_magnitude(v, max_mag);
+    }
+#endif
 }
 
 void Flock::wrap_position(Boid& b, int width, int height) {
@@ -128,44 +234,201 @@ void Flock::wrap_position(Boid& b, int width, int height) {
 }
 
 
-// --- 3. Core Update Loop ---
-void Flock::update(float dt, int width, int height) {
-    // We iterate over the boids using an index to handle the modification
-    // or by creating a temporary copy of the old positions/velocities 
-    // to ensure rules are based on the state at the beginning of the frame.
-    // For simplicity, we iterate and modify in place (using a range-based loop is easiest).
+// --- 3. Flock-wide Sums ---
+
+Flock::StateSums Flock::sum_state() const {
+    int const n = (int)this->boids.size();
+
+    if (not this->deterministic) {
+        // One partial sum per worker: the rounding depends on how ranges were split
+        int const slots = this->jobs ? this->jobs->get_thread_count() : 1;
+        std::vector<StateSums> partial(slots);
+        this->parallel_for(n, [&](int begin, int end) {
+            StateSums& sum = partial[this->jobs ? JobSystem::current_worker() : 0];
+            for (int i = begin; i < end; ++i) {
+                sum.position += this->boids[i].position;
+                sum.velocity += this->boids[i].velocity;
+            }
+        });
+        StateSums total;
+        for (const StateSums& p : partial) {
+            total.position += p.position;
+            total.velocity += p.velocity;
+        }
+        return total;
+    }
+
+    // Deterministic: fixed-size blocks summed in order, then a pairwise tree
+    // over the block sums. Neither shape depends on how blocks map to threads.
+    int const num_blocks = (n + REDUCTION_BLOCK - 1) / REDUCTION_BLOCK;
+    if (num_blocks == 0) {
+        return StateSums();
+    }
+    std::vector<StateSums> block(num_blocks);
+    auto sum_blocks = [&](int begin, int end) {
+        for (int k = begin; k < end; ++k) {
+            int last = std::min(n, (k + 1) * REDUCTION_BLOCK);
+            for (int i = k * REDUCTION_BLOCK; i < last; ++i) {
+                block[k].position += this->boids[i].position;
+                block[k].velocity += this->boids[i].velocity;
+            }
+        }
+    };
+    if (this->jobs) {
+        this->jobs->parallel_for(0, num_blocks, sum_blocks, 1);
+    } else {
+        sum_blocks(0, num_blocks);
+    }
+    for (int stride = 1; stride < num_blocks; stride *= 2) {
+        for (int k = 0; k + stride < num_blocks; k += 2 * stride) {
+            block[k].position += block[k + stride].position;
+            block[k].velocity += block[k + stride].velocity;
+        }
+    }
+    return block[0];
+}
+
+void Flock::parallel_for(int n, std::function<void(int, int)> body) const {
+    if (not this->jobs) {
+        body(0, n);
+        return;
+    }
+    // Not worth a task for a handful of boids
+    int const MIN_BOIDS_PER_TASK = 64;
+    int grain = std::max(MIN_BOIDS_PER_TASK, n / (8 * this->jobs->get_thread_count()));
+    this->jobs->parallel_for(0, n, std::move(body), grain);
+}
+
+// --- 4. Multirate Stepping ---
+
+void Flock::set_multirate(bool on) {
+    this->multirate = on;
+    this->step_state.clear();
+    this->evaluated_total = 0;
+    this->boid_steps_total = 0;
+}
+
+bool Flock::multirate_acceleration(int i, const StateSums& sums) {
+    Boid& b = this->boids[i];
+    StepState& st = this->step_state[i];
+
+    st.age++;
+    if (st.age < (1 << st.level)) {
+        // Calm boid: extrapolate the force trend since the last evaluation
+        Vec2 predicted = st.last_acceleration + st.acceleration_rate * (float)st.age;
+        b.acceleration = limit_magnitude(predicted, this->max_force);
+        return false;
+    }
+
+    int neighbors = 0;
+    Vec2 a = limit_magnitude(compute_acceleration(i, sums, &neighbors), this->max_force);
+
+    // How far off the extrapolation would have been this step
+    Vec2 predicted = st.last_acceleration + st.acceleration_rate * (float)st.age;
+    float error = (a - predicted).magnitude();
+
+    if (neighbors >= DENSE_NEIGHBORS || error > TURBULENT_CHANGE * this->max_force) {
+        st.level = 0;
+    } else if (error < CALM_CHANGE * this->max_force && st.level < MAX_STEP_LEVEL) {
+        st.level++;
+    } else if (error >= CALM_CHANGE * this->max_force && st.level > 0) {
+        st.level--;
+    }
+
+    st.acceleration_rate = (a - st.last_acceleration) / (float)st.age;
+    st.last_acceleration = a;
+    st.age = 0;
+    b.acceleration = a;
+    return true;
+}
+
+// --- 5. Core Update Loop ---
+
+Vec2 Flock::compute_acceleration(int i, const StateSums& sums, int* neighbors) const {
+    const Boid& b = this->boids[i];
+
+    // 1. Calculate Rule Accelerations (Forces)
+    Vec2 a_cohesion = rule_cohesion(b, sums);
+    Vec2 a_separation = rule_separation(b, neighbors);
+    Vec2 a_alignment = rule_alignment(b, sums);
     
-    for (Boid& b : this->boids) {
-        
-        // 1. Calculate Rule Accelerations (Forces)
-        Vec2 a_cohesion = rule_cohesion(b);
-        Vec2 a_separation = rule_separation(b);
-        Vec2 a_alignment = rule_alignment(b);
-        
-        // 2. Apply Weights and Sum (F = ma, where F is the sum of weighted rule accelerations)
-        Vec2 total_acceleration = 
-            a_cohesion * COHESION_WEIGHT + 
-            a_separation * SEPARATION_WEIGHT + 
-            a_alignment * ALIGNMENT_WEIGHT;
-
-        // 3. Limit Acceleration (Force)
-        if (total_acceleration.magnitude() > MAX_FORCE) {
-            total_acceleration = total_acceleration.normalize() * MAX_FORCE;
+    // 2. Apply Weights and Sum (F = ma, where F is the sum of weighted rule accelerations)
+    Vec2 total_acceleration = 
+        a_cohesion * this->cohesion_weight + 
+        a_separation * this->separation_weight + 
+        a_alignment * this->alignment_weight;
+
+    // 3. The caller limits the acceleration (force) to max_force
+    return total_acceleration;
+}
+
+void Flock::update(float dt, int width, int height) {
+    // The rules are evaluated against the state at the beginning of the frame:
+    // phase 1 only reads positions/velocities and writes accelerations, phase 2
+    // integrates. Each boid is therefore independent within a phase, and the
+    // result does not depend on iteration order or on the thread count.
+    auto start = std::chrono::steady_clock::now();
+
+    int const n = (int)this->boids.size();
+    StateSums const sums = this->sum_state();
+
+    // Phase 1: forces
+    if (not this->multirate) {
+        this->parallel_for(n, [&](int begin, int end) {
+            for (int i = begin; i < end; ++i) {
+                this->boids[i].acceleration = compute_acceleration(i, sums);
+            }
+            // Limit Acceleration (Force), as one pass over the range
+            this->limit_magnitudes(&Boid::acceleration, this->max_force, begin, end);
+        });
+    } else {
+        if ((int)this->step_state.size() != n) {
+            // New or resized flock: everyone starts at level 0
+            this->step_state.assign(n, StepState());
+            for (int i = 0; i < n; ++i) {
+                this->step_state[i].last_acceleration = this->boids[i].acceleration;
+            }
         }
+        std::atomic<long long> evaluated(0);
+        this->parallel_for(n, [&](int begin, int end) {
+            long long count = 0;
+            for (int i = begin; i < end; ++i) {
+                count += this->multirate_acceleration(i, sums) ? 1 : 0;
+            }
+            evaluated += count;
+        });
+        this->evaluated_total += evaluated;
+        this->boid_steps_total += n;
+    }
 
-        // 4. Update Boid State
-        b.acceleration = total_acceleration;
-        
-        // Update velocity: v = v + dt * a 
-        b.velocity += b.acceleration * dt;
+    // Phase 2: integration
+    this->parallel_for(n, [&](int begin, int end) {
+        for (int i = begin; i < end; ++i) {
+            // Update velocity: v = v + dt * a 
+            this->boids[i].velocity += this->boids[i].acceleration * dt;
+        }
 
-        // Limit Velocity (Speed)
-        limit_velocity(b);
+        // Limit Velocity (Speed), as one pass over the range
+        this->limit_magnitudes(&Boid::velocity, this->max_speed, begin, end);
 
-        // Update position: p = p + dt * v
-        b.position += b.velocity * dt;
+        for (int i = begin; i < end; ++i) {
+            Boid& b = this->boids[i];
 
-        // Apply boundary conditions (wrap around screen)
-        wrap_position(b, width, height);
+            // Update position: p = p + dt * v
+            b.position += b.velocity * dt;
+
+            // Apply boundary conditions (wrap around screen)
+            wrap_position(b, width, height);
+        }
+    });
+
+    // Re-index the new positions for neighbor queries (next step, analytics, rendering)
+    this->grid_width = width;
+    this->grid_height = height;
+    this->grid.build(this->boids, NEIGHBOR_RADIUS, width, height);
+
+    if (this->analytics) {
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        this->analytics->on_step(this->boids, this->grid, dt, elapsed.count());
     }
-}
\ No newline at end of file
+}
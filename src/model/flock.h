@@ -1,35 +1,93 @@
+#pragma once
+
+#include <functional>
 #include <vector>
 #include <random>
 #include "boid.h" 
 #include "vec2.h"
+#include "spatial_grid.h"
+
+class FlockAnalytics;
+class JobSystem;
 
 /**
  * @brief Manages the entire collection of boids and the core simulation logic.
  */
 class Flock {
 private:
-    const float SEPARATION_DISTANCE = 20.0f;
     std::vector<Boid> boids;
     
-    // Constants for Rule Weights (from the assignment)
-    // These constants will be used to weight the influence of each rule.
-    const float COHESION_WEIGHT = 0.01f;
-    const float SEPARATION_WEIGHT = 0.5f;
-    const float ALIGNMENT_WEIGHT = 0.2f;
-    const float MAX_SPEED = 5.0f;     // Example Max Speed (adjust as needed)
-    const float MAX_FORCE = 0.5f;     // Example Max Acceleration/Force Limit
+    // Rule Weights (defaults from the assignment)
+    // These weight the influence of each rule; they can be tuned with set_params().
+    float cohesion_weight = 0.01f;
+    float separation_weight = 0.5f;
+    float separation_radius = 20.0f; // Repulsion radius of the separation rule
+    float alignment_weight = 0.2f;
+    float max_speed = 5.0f;     // Example Max Speed (adjust as needed)
+    float max_force = 0.5f;     // Example Max Acceleration/Force Limit
+    const float NEIGHBOR_RADIUS = 25.0f; // Cell size of the spatial grid
+
+    // Spatial index over the boids, rebuilt at the end of every update
+    SpatialGrid grid;
+    int grid_width = 0;  // World size the grid was last built for
+    int grid_height = 0;
+
+    // Rebuilds the grid after boids were added or removed
+    void on_boids_changed();
+
+    // Optional metrics stage run after every update (not owned)
+    FlockAnalytics* analytics = nullptr;
 
     // Variables for randomness
     std::default_random_engine engine;
     std::uniform_real_distribution<float> rand_dist;
 
+    // Parallel execution settings (no job system = run on the caller only)
+    JobSystem* jobs = nullptr;
+    bool deterministic = false;
+    static const int REDUCTION_BLOCK = 256; // Boids per leaf of the deterministic sum tree
+
+    // Sums of position and velocity over the whole flock, computed once per step
+    struct StateSums {
+        Vec2 position;
+        Vec2 velocity;
+    };
+    StateSums sum_state() const;
+
+    // Runs body over [0, n) on the job system, or inline without one
+    void parallel_for(int n, std::function<void(int, int)> body) const;
+
+    // Multirate stepping: calm boids re-evaluate their forces every 2^level steps
+    static const int MAX_STEP_LEVEL = 3;   // At most every 8 steps
+    const float CALM_CHANGE = 0.02f;       // Prediction error (x max_force) to move up a level
+    const float TURBULENT_CHANGE = 0.1f;   // Prediction error (x max_force) to drop to level 0
+    static const int DENSE_NEIGHBORS = 8;  // Neighbors inside the separation radius that keep a boid at level 0
+    struct StepState {
+        Vec2 last_acceleration;   // Acceleration at the last evaluation
+        Vec2 acceleration_rate;   // Change per step, used to extrapolate in between
+        int level = 0;
+        int age = 0;              // Steps since the last evaluation
+    };
+    bool multirate = false;
+    std::vector<StepState> step_state;
+    long long evaluated_total = 0;  // Rule evaluations since multirate was enabled
+    long long boid_steps_total = 0; // Boid updates since multirate was enabled
+
+    // Evaluates or extrapolates boid i's acceleration; returns true if evaluated
+    bool multirate_acceleration(int i, const StateSums& sums);
+
     // Helper functions for the three Boids rules
-    Vec2 rule_cohesion(const Boid& b) const;
-    Vec2 rule_separation(const Boid& b) const;
-    Vec2 rule_alignment(const Boid& b) const;
+    Vec2 rule_cohesion(const Boid& b, const StateSums& sums) const;
+    Vec2 rule_separation(const Boid& b, int* neighbors = nullptr) const;
+    Vec2 rule_alignment(const Boid& b, const StateSums& sums) const;
+
+    // Weighted sum of the three rules for boid i, not yet limited to max_force
+    // (neighbors receives the number of boids inside the separation radius)
+    Vec2 compute_acceleration(int i, const StateSums& sums, int* neighbors = nullptr) const;
 
-    // Utility functions for limits and boundaries
-    void limit_velocity(Boid& b);
+    // Utility functions for limits and boundaries. The limit clamps one vector
+    // of boids [begin, end) in a single pass (batched kernel with fast math).
+    void limit_magnitudes(Vec2 Boid::* field, float max_mag, int begin, int end);
     void wrap_position(Boid& b, int width, int height);
 
 public:
@@ -39,6 +97,11 @@ public:
      */
     Flock(int num_boids, int width, int height);
 
+    /**
+     * @brief Constructor with an explicit seed, for reproducible runs.
+     */
+    Flock(int num_boids, int width, int height, unsigned int seed);
+
     /**
      * @brief The core update loop: Calculates rules and updates position/velocity 
      * for all boids over a time step (dt).
@@ -49,4 +112,90 @@ public:
      * @brief Accessor to retrieve the boids vector for rendering.
      */
     const std::vector<Boid>& get_boids() const { return this->boids; }
+
+    /**
+     * @brief Removes every boid for which `pred` returns true and appends it to `out`.
+     * Used to move boids out of the simulated set (e.g. into dormant chunks).
+     * The remaining boids keep their order and their multirate step levels.
+     * @return The number of boids removed.
+     */
+    int extract_boids(const std::function<bool(const Boid&)>& pred, std::vector<Boid>& out);
+
+    /**
+     * @brief Adds boids to the simulated set (e.g. from a chunk paged back in).
+     * They are appended at multirate level 0; existing boids keep their levels.
+     */
+    void add_boids(const Boid* first, std::size_t count);
+
+    /**
+     * @brief Tunable rule weights and limits.
+     */
+    struct Params {
+        float cohesion_weight;
+        float separation_weight;
+        float separation_radius;
+        float alignment_weight;
+        float max_speed;
+        float max_force;
+    };
+    Params get_params() const;
+
+    /**
+     * @brief Replaces the rule weights and limits; takes effect at the next
+     * update(). Resets multirate levels.
+     */
+    void set_params(const Params& params);
+
+    /**
+     * @brief Accessor to the spatial grid built from the current boid positions.
+     */
+    const SpatialGrid& get_grid() const { return this->grid; }
+
+    /**
+     * @brief Attaches a metrics stage that samples the flock after each update
+     * (nullptr detaches). The flock does not take ownership.
+     */
+    void set_analytics(FlockAnalytics* a) { this->analytics = a; }
+
+    /**
+     * @brief Job system update() splits its loops on (nullptr = run on the
+     * caller only). The flock does not take ownership.
+     */
+    void set_job_system(JobSystem* j) { this->jobs = j; }
+
+    /**
+     * @brief In deterministic mode the flock-wide sums use a fixed-shape
+     * reduction tree, so update() gives bitwise identical results for any
+     * thread count. In the default (fast) mode the last bits of the sums may
+     * vary with the number of threads and with work stealing.
+     */
+    void set_deterministic(bool on) { this->deterministic = on; }
+    bool is_deterministic() const { return this->deterministic; }
+
+    /**
+     * @brief Multirate mode: each boid gets a step level from how well its
+     * acceleration can be predicted. Boids at level k re-evaluate the rules
+     * every 2^k steps and extrapolate linearly in between; boids in dense
+     * areas (at least DENSE_NEIGHBORS neighbors inside the separation radius)
+     * or with quickly changing forces stay at level 0 and update every step.
+     * Enabling resets all levels.
+     */
+    void set_multirate(bool on);
+    bool is_multirate() const { return this->multirate; }
+
+    /**
+     * @brief Step level k of boid i: its rules are evaluated every 2^k steps
+     * (0 when multirate is off or before its first update).
+     */
+    int get_step_level(int i) const {
+        return i >= 0 && i < (int)this->step_state.size() ? this->step_state[i].level : 0;
+    }
+
+    /**
+     * @brief Fraction of boid updates that evaluated the rules since
+     * multirate was enabled (1 when it is off).
+     */
+    double get_evaluated_fraction() const {
+        return this->boid_steps_total > 0 ? (double)this->evaluated_total / this->boid_steps_total : 1.0;
+    }
 };
\ No newline at end of file
@@ -0,0 +1,267 @@
+#include "flock_analytics.h"
+#include "../utility/job_system.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+// Below this many boids the union-find is filled on the calling thread
+static const int PARALLEL_THRESHOLD = 2048;
+
+// Out-of-class definition: std::min below binds a reference to it
+const int FlockAnalytics::NN_SAMPLES;
+
+FlockAnalytics::FlockAnalytics(std::string const & path, Format format, int interval, float link_radius)
+    : format(format), interval(std::max(interval, 1)), link_radius(link_radius) {
+
+    this->out = std::fopen(path.c_str(), format == Format::CSV ? "w" : "wb");
+    if (not this->out) {
+        return;
+    }
+    // Samples are small and frequent; let stdio batch them into large writes
+    std::setvbuf(this->out, nullptr, _IOFBF, 1 << 16);
+
+    if (format == Format::CSV) {
+        std::fputs("step,time,num_boids,polarization,mean_speed,mean_nn_distance,clusters,largest_cluster,overhead\n", this->out);
+    } else {
+        std::uint32_t const version = 1;
+        std::uint32_t const record_size = sizeof(FlockMetrics);
+        std::fwrite("FLKA", 1, 4, this->out);
+        std::fwrite(&version, sizeof(version), 1, this->out);
+        std::fwrite(&record_size, sizeof(record_size), 1, this->out);
+    }
+}
+
+FlockAnalytics::~FlockAnalytics() {
+    if (this->out) {
+        std::fclose(this->out);
+    }
+}
+
+bool FlockAnalytics::parse_format(std::string const & name, Format& format) {
+    if (name == "csv") { format = Format::CSV; return true; }
+    if (name == "bin") { format = Format::BINARY; return true; }
+    return false;
+}
+
+void FlockAnalytics::on_step(const std::vector<Boid>& boids, const SpatialGrid& grid, float dt, double update_seconds) {
+    this->step++;
+    this->time += dt;
+    this->update_seconds += update_seconds;
+
+    if (this->step % this->interval != 0) {
+        return;
+    }
+    if (this->max_overhead > 0.0 && this->overhead() > this->max_overhead) {
+        this->postponed++;
+        return;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+
+    FlockMetrics m = this->compute(boids, grid);
+    m.step = this->step;
+    m.time = this->time;
+    this->write(m);
+
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    this->analytics_seconds += elapsed.count();
+    this->last = m;
+    this->last.overhead = (float)this->overhead();
+}
+
+void FlockAnalytics::write(const FlockMetrics& m) {
+    if (not this->out) {
+        return;
+    }
+    if (this->format == Format::CSV) {
+        std::fprintf(this->out, "%llu,%.4f,%u,%.6f,%.6f,%.6f,%u,%u,%.6f\n",
+                (unsigned long long)m.step, m.time, m.num_boids,
+                m.polarization, m.mean_speed, m.mean_nn_distance,
+                m.clusters, m.largest_cluster, this->overhead());
+    } else {
+        FlockMetrics record = m;
+        record.overhead = (float)this->overhead();
+        std::fwrite(&record, sizeof(record), 1, this->out);
+    }
+}
+
+// --- Metrics ---
+
+FlockMetrics FlockAnalytics::compute(const std::vector<Boid>& boids, const SpatialGrid& grid) {
+    FlockMetrics m;
+    int const n = (int)boids.size();
+    m.num_boids = (std::uint32_t)n;
+    if (n == 0) {
+        return m;
+    }
+
+    // Order parameter and mean speed: one linear pass
+    Vec2 heading_sum = {0.0f, 0.0f};
+    double speed_sum = 0.0;
+    for (const Boid& b : boids) {
+        float speed_sq = b.velocity.magnitude_sq();
+        if (speed_sq > 0.0f) {
+            float speed = std::sqrt(speed_sq);
+            heading_sum += b.velocity / speed;
+            speed_sum += speed;
+        }
+    }
+    m.polarization = heading_sum.magnitude() / n;
+    m.mean_speed = (float)(speed_sum / n);
+
+    // Private grid fine enough that a cell fits inside the link radius
+    int const width = (int)std::lround(grid.get_cols() * grid.get_cell_width());
+    int const height = (int)std::lround(grid.get_rows() * grid.get_cell_height());
+    this->link_grid.build(boids, this->link_radius * 0.7f, width, height);
+
+    // Cluster links, split across workers by grid rows for large flocks
+    this->reset_sets(n);
+    auto run_rows = [&](int begin, int end) {
+        this->link_rows(boids, begin, end);
+    };
+    if (this->jobs && n >= PARALLEL_THRESHOLD) {
+        this->jobs->parallel_for(0, this->link_grid.get_rows(), run_rows);
+    } else {
+        run_rows(0, this->link_grid.get_rows());
+    }
+
+    // Nearest neighbors of an evenly spread sample (a dense clump makes each query O(n))
+    int const samples = std::min(n, NN_SAMPLES);
+    double total_nn = 0.0;
+    int total_count = 0;
+    for (int s = 0; s < samples; ++s) {
+        int const i = (int)((long long)s * n / samples);
+        float d_sq;
+        if (this->link_grid.nearest(boids, boids[i].position, i, d_sq) >= 0) {
+            total_nn += std::sqrt(d_sq);
+            total_count++;
+        }
+    }
+    m.mean_nn_distance = total_count > 0 ? (float)(total_nn / total_count) : 0.0f;
+
+    // Count components and the largest one
+    this->cluster_size.assign(n, 0);
+    for (int i = 0; i < n; ++i) {
+        std::uint32_t& size = this->cluster_size[this->find(i)];
+        if (size == 0) {
+            m.clusters++;
+        }
+        size++;
+        m.largest_cluster = std::max(m.largest_cluster, size);
+    }
+
+    return m;
+}
+
+void FlockAnalytics::link_rows(const std::vector<Boid>& boids, int row_begin, int row_end) {
+    SpatialGrid const & g = this->link_grid;
+    float const r_sq = this->link_radius * this->link_radius;
+    float const cw = g.get_cell_width();
+    float const ch = g.get_cell_height();
+    // False only if the grid hit its size cap; then cells are tested pair by pair
+    bool const cell_linked = cw * cw + ch * ch < r_sq;
+    int const reach_x = (int)std::ceil(this->link_radius / cw);
+    int const reach_y = (int)std::ceil(this->link_radius / ch);
+
+    for (int cy = row_begin; cy < row_end; ++cy) {
+        for (int cx = 0; cx < g.get_cols(); ++cx) {
+            const int* a0 = g.cell_begin(cx, cy);
+            const int* a1 = g.cell_end(cx, cy);
+            if (a0 == a1) {
+                continue;
+            }
+
+            // Boids sharing a cell
+            for (const int* a = a0 + 1; a < a1; ++a) {
+                if (cell_linked) {
+                    this->unite(*a0, *a);
+                    continue;
+                }
+                for (const int* b = a0; b < a; ++b) {
+                    if (distance_sq(boids[*a].position, boids[*b].position) < r_sq) {
+                        this->unite(*a, *b);
+                    }
+                }
+            }
+
+            // Each pair of cells once: later cells of this row, then the rows below
+            for (int dy = 0; dy <= reach_y && cy + dy < g.get_rows(); ++dy) {
+                for (int dx = (dy == 0 ? 1 : -reach_x); dx <= reach_x; ++dx) {
+                    int const nx = cx + dx;
+                    if (nx < 0 || nx >= g.get_cols()) {
+                        continue;
+                    }
+                    float const gap_x = std::max(std::abs(dx) - 1, 0) * cw;
+                    float const gap_y = std::max(dy - 1, 0) * ch;
+                    if (gap_x * gap_x + gap_y * gap_y >= r_sq) {
+                        continue;
+                    }
+                    const int* b0 = g.cell_begin(nx, cy + dy);
+                    const int* b1 = g.cell_end(nx, cy + dy);
+                    if (b0 == b1 || (cell_linked && this->find(*a0) == this->find(*b0))) {
+                        continue;
+                    }
+                    // With whole cells linked, one close pair joins both cells
+                    bool joined = false;
+                    for (const int* a = a0; a < a1 && not joined; ++a) {
+                        for (const int* b = b0; b < b1; ++b) {
+                            if (distance_sq(boids[*a].position, boids[*b].position) < r_sq) {
+                                this->unite(*a, *b);
+                                if (cell_linked) {
+                                    joined = true;
+                                    break;
+                                }
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
+
+// --- Concurrent Union-Find ---
+// Roots are always linked towards the smaller index, so concurrent unions
+// cannot form cycles; find() compresses paths with CAS (path halving).
+
+void FlockAnalytics::reset_sets(int n) {
+    if (n > this->parent_capacity) {
+        this->parent.reset(new std::atomic<int>[n]);
+        this->parent_capacity = n;
+    }
+    for (int i = 0; i < n; ++i) {
+        this->parent[i].store(i, std::memory_order_relaxed);
+    }
+}
+
+int FlockAnalytics::find(int i) {
+    for (;;) {
+        int p = this->parent[i].load(std::memory_order_acquire);
+        if (p == i) {
+            return i;
+        }
+        int gp = this->parent[p].load(std::memory_order_acquire);
+        if (p != gp) {
+            this->parent[i].compare_exchange_weak(p, gp, std::memory_order_acq_rel);
+        }
+        i = gp;
+    }
+}
+
+void FlockAnalytics::unite(int a, int b) {
+    for (;;) {
+        a = this->find(a);
+        b = this->find(b);
+        if (a == b) {
+            return;
+        }
+        if (a < b) {
+            std::swap(a, b);
+        }
+        // Link the larger root under the smaller; fails if a stopped being a root
+        int expected = a;
+        if (this->parent[a].compare_exchange_strong(expected, b, std::memory_order_acq_rel)) {
+            return;
+        }
+    }
+}
@@ -0,0 +1,137 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <vector>
+#include "boid.h"
+#include "spatial_grid.h"
+
+class JobSystem;
+
+/**
+ * @brief One sample of flock-level metrics.
+ * * The layout is fixed (no implicit padding) because the binary sink writes
+ * it as-is after a small header.
+ */
+struct FlockMetrics {
+    std::uint64_t step = 0;           // Simulation step the sample was taken after
+    double time = 0.0;                // Simulated time (sum of dt)
+    std::uint32_t num_boids = 0;
+    std::uint32_t clusters = 0;       // Connected components under the link radius
+    std::uint32_t largest_cluster = 0;
+    float polarization = 0.0f;        // |mean of unit velocities|, 0 = disordered, 1 = aligned
+    float mean_speed = 0.0f;
+    float mean_nn_distance = 0.0f;    // Mean distance to the nearest neighbor
+    float overhead = 0.0f;            // Analytics time / update time so far
+    std::uint32_t reserved = 0;
+};
+
+/**
+ * @brief Samples flock metrics from inside Flock::update and streams them to a file.
+ * * Runs every `interval` steps. Cost stays near-linear even when the flock
+ * collapses into a dense clump:
+ * * Clusters come from a lock-free union-find over a private grid whose cells
+ * are at most link_radius across, so boids sharing a cell are linked without
+ * distance tests and each pair of nearby cells stops at its first link. The
+ * union-find is filled in parallel on the job system for large flocks.
+ * * The mean nearest-neighbor distance is estimated from at most NN_SAMPLES
+ * boids spread evenly over the flock.
+ * * A sample is postponed to a later interval while the analytics time so far
+ * exceeds `max_overhead` of the update time.
+ */
+class FlockAnalytics {
+public:
+    enum class Format {
+        CSV,    // Header line plus one text line per sample
+        BINARY  // "FLKA", version, record size, then raw FlockMetrics records
+    };
+
+    /**
+     * @brief Opens the sink.
+     * @param path Output file.
+     * @param format CSV or binary records.
+     * @param interval Sample every this many steps (1 = every step).
+     * @param link_radius Two boids closer than this belong to the same cluster.
+     */
+    FlockAnalytics(std::string const & path, Format format, int interval = 10, float link_radius = 25.0f);
+    ~FlockAnalytics();
+
+    FlockAnalytics(FlockAnalytics const &) = delete;
+    FlockAnalytics& operator=(FlockAnalytics const &) = delete;
+
+    bool is_ok() const { return this->out != nullptr; }
+
+    /**
+     * @brief Called by the flock after each step.
+     * @param boids Boid state after the step.
+     * @param grid Spatial grid built from that state.
+     * @param dt The step's time delta.
+     * @param update_seconds Wall time the step itself took (for overhead reporting).
+     */
+    void on_step(const std::vector<Boid>& boids, const SpatialGrid& grid, float dt, double update_seconds);
+
+    /**
+     * @brief Computes the metrics for the given state (also usable without a sink).
+     */
+    FlockMetrics compute(const std::vector<Boid>& boids, const SpatialGrid& grid);
+
+    const FlockMetrics& latest() const { return this->last; }
+
+    /**
+     * @brief Fraction of simulation time spent in analytics so far.
+     */
+    double overhead() const {
+        return this->update_seconds > 0.0 ? this->analytics_seconds / this->update_seconds : 0.0;
+    }
+
+    static bool parse_format(std::string const & name, Format& format);
+
+    /**
+     * @brief Job system used for large flocks (nullptr = run on the caller only).
+     */
+    void set_job_system(JobSystem* j) { this->jobs = j; }
+
+    /**
+     * @brief Largest fraction of update time analytics may take (0 = no limit).
+     */
+    void set_max_overhead(double fraction) { this->max_overhead = fraction; }
+
+    /**
+     * @brief Samples skipped so far to stay within max_overhead.
+     */
+    std::uint64_t get_postponed() const { return this->postponed; }
+
+    // Boids whose nearest neighbor is measured per sample
+    static const int NN_SAMPLES = 128;
+
+private:
+    void write(const FlockMetrics& m);
+
+    // --- Concurrent union-find ---
+    void reset_sets(int n);
+    int find(int i);
+    void unite(int a, int b);
+    void link_rows(const std::vector<Boid>& boids, int row_begin, int row_end);
+
+    std::FILE * out = nullptr;
+    JobSystem* jobs = nullptr;
+    Format format;
+    int interval;
+    float link_radius;
+    double max_overhead = 0.03;
+    SpatialGrid link_grid;
+
+    std::uint64_t step = 0;
+    std::uint64_t postponed = 0;
+    double time = 0.0;
+    double analytics_seconds = 0.0;
+    double update_seconds = 0.0;
+    FlockMetrics last;
+
+    std::unique_ptr<std::atomic<int>[]> parent;
+    int parent_capacity = 0;
+    std::vector<std::uint32_t> cluster_size;
+};
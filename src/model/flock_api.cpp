@@ -0,0 +1,152 @@
+#include "flock_api.h"
+#include <cstddef>
+#include <memory>
+#include <new>
+#include "flock.h"
+#include "../utility/job_system.h"
+
+// The state accessors hand out pointers into the boid vector
+static_assert(offsetof(Boid, position) == 0, "position must start each boid record");
+static_assert(offsetof(Boid, velocity) == 2 * sizeof(float), "velocity must follow position");
+static_assert(sizeof(Vec2) == 2 * sizeof(float), "Vec2 must be two packed floats");
+
+struct flock_s {
+    flock_s(int num_boids, int width, int height, unsigned int seed)
+        : flock(num_boids, width, height, seed), width(width), height(height) {}
+
+    Flock flock;
+    int width;
+    int height;
+    std::unique_ptr<JobSystem> jobs;
+};
+
+int flock_api_version(void) {
+    return FLOCK_API_VERSION;
+}
+
+flock_t * flock_create(int num_boids, int width, int height, unsigned int seed) {
+    if (num_boids < 0 || width <= 0 || height <= 0) {
+        return nullptr;
+    }
+    // Nothing may propagate out of a C entry point: every function that can
+    // throw (allocation in the grid, the job system...) catches everything
+    try {
+        return new flock_s(num_boids, width, height, seed);
+    } catch (...) {
+        return nullptr;
+    }
+}
+
+void flock_destroy(flock_t * flock) {
+    // Destructors do not throw; the accessors below only read
+    delete flock;
+}
+
+int flock_step(flock_t * flock, float dt, int steps) {
+    if (!flock || steps < 0) {
+        return -1;
+    }
+    try {
+        for (int s = 0; s < steps; ++s) {
+            flock->flock.update(dt, flock->width, flock->height);
+        }
+    } catch (...) {
+        return -1;
+    }
+    return 0;
+}
+
+int flock_set_param(flock_t * flock, flock_param_t param, float value) {
+    if (!flock || !(value >= 0.0f)) {
+        return -1;
+    }
+    try {
+        Flock::Params p = flock->flock.get_params();
+        switch (param) {
+            case FLOCK_PARAM_COHESION_WEIGHT: p.cohesion_weight = value; break;
+            case FLOCK_PARAM_SEPARATION_WEIGHT: p.separation_weight = value; break;
+            case FLOCK_PARAM_ALIGNMENT_WEIGHT: p.alignment_weight = value; break;
+            case FLOCK_PARAM_MAX_SPEED: p.max_speed = value; break;
+            case FLOCK_PARAM_MAX_FORCE: p.max_force = value; break;
+            case FLOCK_PARAM_SEPARATION_RADIUS: p.separation_radius = value; break;
+            default: return -1;
+        }
+        flock->flock.set_params(p);
+    } catch (...) {
+        return -1;
+    }
+    return 0;
+}
+
+int flock_get_param(flock_t const * flock, flock_param_t param, float * value) {
+    if (!flock || !value) {
+        return -1;
+    }
+    try {
+        Flock::Params p = flock->flock.get_params();
+        switch (param) {
+            case FLOCK_PARAM_COHESION_WEIGHT: *value = p.cohesion_weight; break;
+            case FLOCK_PARAM_SEPARATION_WEIGHT: *value = p.separation_weight; break;
+            case FLOCK_PARAM_ALIGNMENT_WEIGHT: *value = p.alignment_weight; break;
+            case FLOCK_PARAM_MAX_SPEED: *value = p.max_speed; break;
+            case FLOCK_PARAM_MAX_FORCE: *value = p.max_force; break;
+            case FLOCK_PARAM_SEPARATION_RADIUS: *value = p.separation_radius; break;
+            default: return -1;
+        }
+    } catch (...) {
+        return -1;
+    }
+    return 0;
+}
+
+int flock_set_threads(flock_t * flock, int threads) {
+    if (!flock || threads < 0) {
+        return -1;
+    }
+    try {
+        flock->flock.set_job_system(nullptr);
+        flock->jobs.reset();
+        if (threads != 1) {
+            flock->jobs.reset(new JobSystem(threads));
+            flock->flock.set_job_system(flock->jobs.get());
+        }
+    } catch (...) {
+        return -1;
+    }
+    return 0;
+}
+
+int flock_set_deterministic(flock_t * flock, int on) {
+    if (!flock) {
+        return -1;
+    }
+    try {
+        flock->flock.set_deterministic(on != 0);
+    } catch (...) {
+        return -1;
+    }
+    return 0;
+}
+
+int flock_count(flock_t const * flock) {
+    return flock ? (int)flock->flock.get_boids().size() : 0;
+}
+
+size_t flock_stride(flock_t const * flock) {
+    (void)flock;
+    return sizeof(Boid);
+}
+
+float const * flock_positions(flock_t const * flock) {
+    if (!flock || flock->flock.get_boids().empty()) {
+        return nullptr;
+    }
+    return &flock->flock.get_boids().front().position.x;
+}
+
+float const * flock_velocities(flock_t const * flock) {
+    if (!flock || flock->flock.get_boids().empty()) {
+        return nullptr;
+    }
+    return &flock->flock.get_boids().front().velocity.x;
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+/**
+ * @brief C interface to the flocking engine (libflock).
+ * * Opaque handle, plain types and return codes only, so it can be used from
+ * C and through foreign function interfaces. Functions returning int give 0
+ * on success and -1 on invalid arguments or failure (e.g. out of memory); no
+ * C++ exception ever leaves the library. A handle must not be used from
+ * several threads at once; flock_set_threads() parallelizes a single step.
+ *
+ * The boid state is read in place: flock_positions() and flock_velocities()
+ * return pointers to {x, y} float pairs spaced flock_stride() bytes apart.
+ * The pointers stay valid, and see the new values, across flock_step()
+ * calls until the handle is destroyed.
+ */
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Bumped when the interface changes incompatibly. */
+#define FLOCK_API_VERSION 1
+
+typedef struct flock_s flock_t;
+
+typedef enum {
+    FLOCK_PARAM_COHESION_WEIGHT = 0,
+    FLOCK_PARAM_SEPARATION_WEIGHT = 1,
+    FLOCK_PARAM_ALIGNMENT_WEIGHT = 2,
+    FLOCK_PARAM_MAX_SPEED = 3,
+    FLOCK_PARAM_MAX_FORCE = 4,
+    FLOCK_PARAM_SEPARATION_RADIUS = 5 /* world units */
+} flock_param_t;
+
+/** Returns FLOCK_API_VERSION of the library actually loaded. */
+int flock_api_version(void);
+
+/**
+ * @brief Creates a flock of num_boids boids at random positions in a
+ * width x height world (wrapping at the edges). The same seed gives the same
+ * initial state. Returns NULL on invalid arguments or allocation failure.
+ */
+flock_t * flock_create(int num_boids, int width, int height, unsigned int seed);
+
+void flock_destroy(flock_t * flock);
+
+/**
+ * @brief Advances the simulation by `steps` steps of `dt` each. On failure
+ * fewer steps may have been taken; the handle stays usable.
+ */
+int flock_step(flock_t * flock, float dt, int steps);
+
+int flock_set_param(flock_t * flock, flock_param_t param, float value);
+int flock_get_param(flock_t const * flock, flock_param_t param, float * value);
+
+/**
+ * @brief Number of threads used inside flock_step() (1 = caller only,
+ * 0 = one per hardware thread).
+ */
+int flock_set_threads(flock_t * flock, int threads);
+
+/**
+ * @brief Non-zero: results are bitwise identical for any thread count
+ * (slightly slower reductions).
+ */
+int flock_set_deterministic(flock_t * flock, int on);
+
+int flock_count(flock_t const * flock);
+
+/** Distance in bytes between consecutive boids in the state buffers. */
+size_t flock_stride(flock_t const * flock);
+
+float const * flock_positions(flock_t const * flock);
+float const * flock_velocities(flock_t const * flock);
+
+#ifdef __cplusplus
+}
+#endif
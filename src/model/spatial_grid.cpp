@@ -0,0 +1,82 @@
+#include "spatial_grid.h"
+
+// Out-of-class definition: std::min below binds a reference to it
+const int SpatialGrid::MAX_CELLS_PER_AXIS;
+
+void SpatialGrid::build(const std::vector<Boid>& boids, float cell_size, int width, int height) {
+    // Pick the cell count per axis, capped so the offset table stays small
+    this->cols = std::max(1, std::min(MAX_CELLS_PER_AXIS, (int)std::ceil(width / cell_size)));
+    this->rows = std::max(1, std::min(MAX_CELLS_PER_AXIS, (int)std::ceil(height / cell_size)));
+    this->cell_w = std::max((float)width / this->cols, 1e-3f);
+    this->cell_h = std::max((float)height / this->rows, 1e-3f);
+
+    int const num_cells = this->cols * this->rows;
+    int const n = (int)boids.size();
+
+    this->cell_start.assign(num_cells + 1, 0);
+    this->indices.resize(n);
+    this->cell_of.resize(n);
+
+    // Counting sort: histogram, prefix sum, scatter (keeps index order within a cell)
+    for (int i = 0; i < n; ++i) {
+        int c = this->cell_y(boids[i].position.y) * this->cols + this->cell_x(boids[i].position.x);
+        this->cell_of[i] = c;
+        this->cell_start[c + 1]++;
+    }
+    for (int c = 0; c < num_cells; ++c) {
+        this->cell_start[c + 1] += this->cell_start[c];
+    }
+    std::vector<int> fill(this->cell_start.begin(), this->cell_start.end() - 1);
+    for (int i = 0; i < n; ++i) {
+        this->indices[fill[this->cell_of[i]]++] = i;
+    }
+}
+
+int SpatialGrid::nearest(const std::vector<Boid>& boids, const Vec2& p, int self, float& out_dist_sq) const {
+    int best = -1;
+    float best_sq = 0.0f;
+    if (this->cell_start.empty()) {
+        return best;
+    }
+
+    int const cx = this->cell_x(p.x);
+    int const cy = this->cell_y(p.y);
+    float const min_cell = std::min(this->cell_w, this->cell_h);
+    int const max_ring = std::max(this->cols, this->rows);
+
+    for (int r = 0; r <= max_ring; ++r) {
+        for (int y = cy - r; y <= cy + r; ++y) {
+            if (y < 0 || y >= this->rows) {
+                continue;
+            }
+            // Full rows at the top and bottom of the ring, only the two ends in between
+            int step = (y == cy - r || y == cy + r) ? 1 : std::max(2 * r, 1);
+            for (int x = cx - r; x <= cx + r; x += step) {
+                if (x < 0 || x >= this->cols) {
+                    continue;
+                }
+                int c = y * this->cols + x;
+                for (int k = this->cell_start[c]; k < this->cell_start[c + 1]; ++k) {
+                    int j = this->indices[k];
+                    if (j == self) {
+                        continue;
+                    }
+                    float d_sq = distance_sq(p, boids[j].position);
+                    if (best < 0 || d_sq < best_sq) {
+                        best = j;
+                        best_sq = d_sq;
+                    }
+                }
+            }
+        }
+
+        // Every cell of the next ring is at least r * min_cell away from p
+        float reach = r * min_cell;
+        if (best >= 0 && best_sq <= reach * reach) {
+            break;
+        }
+    }
+
+    out_dist_sq = best_sq;
+    return best;
+}
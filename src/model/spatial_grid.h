@@ -0,0 +1,102 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+#include "boid.h"
+#include "vec2.h"
+
+/**
+ * @brief Uniform grid over the world that buckets boid indices by cell.
+ * * Built once per step from the flock (counting sort, no per-cell allocations)
+ * and shared by everything that needs neighbors or area queries. Queries
+ * return candidate indices only; callers apply their own exact distance test
+ * against whatever positions they consider current.
+ */
+class SpatialGrid {
+public:
+    // Upper bound on cells per axis so huge worlds do not allocate huge grids
+    static const int MAX_CELLS_PER_AXIS = 1024;
+
+    /**
+     * @brief Rebuilds the grid from the boids' current positions.
+     * @param boids The flock's boids; indices into this vector are stored.
+     * @param cell_size Preferred cell edge (usually the largest query radius).
+     * @param width World width.
+     * @param height World height.
+     */
+    void build(const std::vector<Boid>& boids, float cell_size, int width, int height);
+
+    /**
+     * @brief Calls visit(index) for every boid in the cells overlapped by the
+     * square of half-size radius around p. Cells are visited row by row and
+     * boids within a cell in ascending index order.
+     */
+    template <class Visitor>
+    void for_each_near(const Vec2& p, float radius, Visitor visit) const {
+        this->for_each_in_rect(p.x - radius, p.y - radius, p.x + radius, p.y + radius, visit);
+    }
+
+    /**
+     * @brief Calls visit(index) for every boid in the cells overlapped by [x0,x1] x [y0,y1].
+     */
+    template <class Visitor>
+    void for_each_in_rect(float x0, float y0, float x1, float y1, Visitor visit) const {
+        if (this->cell_start.empty()) {
+            return;
+        }
+        int cx0 = this->cell_x(x0), cx1 = this->cell_x(x1);
+        int cy0 = this->cell_y(y0), cy1 = this->cell_y(y1);
+        for (int cy = cy0; cy <= cy1; ++cy) {
+            for (int cx = cx0; cx <= cx1; ++cx) {
+                int c = cy * this->cols + cx;
+                for (int k = this->cell_start[c]; k < this->cell_start[c + 1]; ++k) {
+                    visit(this->indices[k]);
+                }
+            }
+        }
+    }
+
+    /**
+     * @brief Index of the boid closest to p (excluding `self`), or -1 if the grid
+     * holds no other boid. Searches outward ring by ring and stops once no
+     * unvisited cell can hold anything closer.
+     * @param out_dist_sq Receives the squared distance to the returned boid.
+     */
+    int nearest(const std::vector<Boid>& boids, const Vec2& p, int self, float& out_dist_sq) const;
+
+    /**
+     * @brief Boid indices stored in cell (cx, cy), ascending, as [cell_begin, cell_end).
+     */
+    const int* cell_begin(int cx, int cy) const {
+        return this->indices.data() + this->cell_start[cy * this->cols + cx];
+    }
+    const int* cell_end(int cx, int cy) const {
+        return this->indices.data() + this->cell_start[cy * this->cols + cx + 1];
+    }
+
+    int get_cols() const { return this->cols; }
+    int get_rows() const { return this->rows; }
+    float get_cell_width() const { return this->cell_w; }
+    float get_cell_height() const { return this->cell_h; }
+    bool empty() const { return this->indices.empty(); }
+
+private:
+    int cell_x(float x) const {
+        int c = (int)std::floor(x / this->cell_w);
+        return std::min(std::max(c, 0), this->cols - 1);
+    }
+    int cell_y(float y) const {
+        int c = (int)std::floor(y / this->cell_h);
+        return std::min(std::max(c, 0), this->rows - 1);
+    }
+
+    int cols = 0;
+    int rows = 0;
+    float cell_w = 1.0f;
+    float cell_h = 1.0f;
+
+    std::vector<int> cell_start; // cols*rows + 1 offsets into indices
+    std::vector<int> indices;    // boid indices sorted by cell
+    std::vector<int> cell_of;    // scratch: cell of each boid during build
+};
@@ -0,0 +1,6 @@
+#!/bin/sh
+# Golden-trajectory check run by `make check`: the default flock (4000 boids,
+# 200 steps) must end in the committed state hash for 1..4 threads.
+# Regenerate the golden file only for intended changes to the simulation:
+#   ./flock-determinism --threads 4 --write-golden tools/flock_determinism.golden
+exec ./flock-determinism --threads 4 --golden "${srcdir:-.}/tools/flock_determinism.golden"
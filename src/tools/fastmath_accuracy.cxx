@@ -0,0 +1,134 @@
+// Accuracy harness for model/fastmath.h.
+//
+// Sweeps each approximate kernel over a log-spaced range of inputs and
+// reports the maximum ULP and relative error against the exact path
+// (std::sqrt + divide, as used by Vec2). The batched kernels ("[]") run over
+// the same inputs, clamp_magnitude strided over a boid array as in the
+// flock update. Fails (exit status 1) if a kernel exceeds the relative error
+// documented in fastmath.h; run by `make check`.
+
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+#include "../model/boid.h"
+#include "../model/vec2.h"
+#include "../model/fastmath.h"
+
+struct error_stats_t {
+	double max_ulp = 0.0;
+	double max_rel = 0.0;
+
+	void add(float approx, float exact) {
+		double ulp = ulp_distance(approx, exact);
+		if (ulp > max_ulp) max_ulp = ulp;
+		if (exact != 0.0f) {
+			double rel = std::fabs(((double)approx - exact) / exact);
+			if (rel > max_rel) max_rel = rel;
+		}
+	}
+
+	static double ulp_distance(float a, float b) {
+		return std::fabs((double)ordered(a) - (double)ordered(b));
+	}
+
+	// Maps float bit patterns onto a monotonic integer line.
+	static std::int64_t ordered(float f) {
+		std::int32_t i;
+		std::memcpy(&i, &f, sizeof(i));
+		return i < 0 ? (std::int64_t)INT32_MIN - i : i;
+	}
+};
+
+// Maximum relative error of one rsqrt per Newton step count (0, 1, 2)
+double const REL_LIMIT[3] = {3.5e-2, 1.8e-3, 5.0e-6};
+
+// Prints one row; returns false if the error is over `limit`
+bool report(char const * name, int steps, error_stats_t const & e, double limit) {
+	bool ok = e.max_rel <= limit;
+	std::printf("%-24s newton=%d  max_ulp=%10.1f  max_rel=%.3e  limit=%.1e  %s\n",
+			name, steps, e.max_ulp, e.max_rel, limit, ok ? "ok" : "FAIL");
+	return ok;
+}
+
+int main(int argc, char ** argv)
+{
+	int const samples = argc > 1 ? std::atoi(argv[1]) : 1000000;
+
+	std::mt19937 eng(12345);
+	// Magnitudes from 1e-4 to 1e4 cover distances, speeds and forces.
+	std::uniform_real_distribution<float> log_mag(-4.0f, 4.0f);
+	std::uniform_real_distribution<float> angle(0.0f, 6.2831853f);
+
+	bool ok = true;
+	for (int steps = 0; steps <= 2; ++steps) {
+		error_stats_t e_rsqrt, e_norm, e_clamp, e_inv;
+		error_stats_t e_norm_batch, e_clamp_batch, e_inv_batch;
+		std::mt19937 local = eng;
+		float const max_mag = 5.0f;
+
+		// Inputs for the batched kernels: a plain array and a boid array
+		std::vector<Vec2> inputs(samples);
+		std::vector<Boid> boids(samples);
+
+		for (int i = 0; i < samples; ++i) {
+			float mag = std::pow(10.0f, log_mag(local));
+			float a = angle(local);
+			Vec2 v{mag * std::cos(a), mag * std::sin(a)};
+			float mag_sq = v.magnitude_sq();
+			inputs[i] = v;
+			boids[i].velocity = v;
+
+			e_rsqrt.add(fastmath::rsqrt(mag_sq, steps), 1.0f / std::sqrt(mag_sq));
+
+			Vec2 n_fast = fastmath::normalize(v, steps);
+			Vec2 n_exact = v.normalize();
+			e_norm.add(n_fast.x, n_exact.x);
+			e_norm.add(n_fast.y, n_exact.y);
+
+			Vec2 c_fast = fastmath::clamp_magnitude(v, max_mag, steps);
+			Vec2 c_exact = v.magnitude() > max_mag ? v.normalize() * max_mag : v;
+			e_clamp.add(c_fast.x, c_exact.x);
+			e_clamp.add(c_fast.y, c_exact.y);
+
+			Vec2 w_fast = fastmath::inverse_square_weight(v, steps);
+			Vec2 w_exact = v / mag_sq;
+			e_inv.add(w_fast.x, w_exact.x);
+			e_inv.add(w_fast.y, w_exact.y);
+		}
+
+		std::vector<Vec2> normalized(inputs), weighted(inputs);
+		fastmath::normalize(normalized.data(), normalized.size(), sizeof(Vec2), steps);
+		fastmath::inverse_square_weight(weighted.data(), weighted.size(), sizeof(Vec2), steps);
+		fastmath::clamp_magnitude(&boids[0].velocity, boids.size(), max_mag, sizeof(Boid), steps);
+		for (int i = 0; i < samples; ++i) {
+			Vec2 const & v = inputs[i];
+			Vec2 n_exact = v.normalize();
+			e_norm_batch.add(normalized[i].x, n_exact.x);
+			e_norm_batch.add(normalized[i].y, n_exact.y);
+
+			Vec2 c_exact = v.magnitude() > max_mag ? v.normalize() * max_mag : v;
+			e_clamp_batch.add(boids[i].velocity.x, c_exact.x);
+			e_clamp_batch.add(boids[i].velocity.y, c_exact.y);
+
+			Vec2 w_exact = v / v.magnitude_sq();
+			e_inv_batch.add(weighted[i].x, w_exact.x);
+			e_inv_batch.add(weighted[i].y, w_exact.y);
+		}
+
+		double const limit = REL_LIMIT[steps];
+		ok = report("rsqrt", steps, e_rsqrt, limit) && ok;
+		ok = report("normalize", steps, e_norm, limit) && ok;
+		ok = report("clamp_magnitude", steps, e_clamp, limit) && ok;
+		// r * r: the relative error of the estimate counts twice
+		ok = report("inverse_square_weight", steps, e_inv, 2.0 * limit) && ok;
+		ok = report("normalize[]", steps, e_norm_batch, limit) && ok;
+		ok = report("clamp_magnitude[]", steps, e_clamp_batch, limit) && ok;
+		ok = report("inverse_square_weight[]", steps, e_inv_batch, 2.0 * limit) && ok;
+	}
+
+	return ok ? 0 : 1;
+}
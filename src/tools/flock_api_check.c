@@ -0,0 +1,84 @@
+/* C host for libflock, run by `make check`.
+ *
+ * Built as C99 so it catches C++-only constructs in flock_api.h, and linked
+ * against the library like any embedding program would. Checks argument
+ * validation, parameter round trips, the in-place state buffers, and that
+ * deterministic mode gives the same state for 1 and 4 threads. */
+
+#include <stdio.h>
+#include <string.h>
+#include "../model/flock_api.h"
+
+static int failures = 0;
+
+static void check(int ok, char const * what)
+{
+	printf("%-52s %s\n", what, ok ? "ok" : "FAILED");
+	if (!ok) {
+		failures++;
+	}
+}
+
+/* Runs a seeded flock and copies its final positions into out */
+static int run(int threads, float * out, int n)
+{
+	flock_t * f = flock_create(n, 800, 600, 2024u);
+	int ok = f != NULL
+	      && flock_set_threads(f, threads) == 0
+	      && flock_set_deterministic(f, 1) == 0
+	      && flock_step(f, 0.1f, 50) == 0;
+	if (ok) {
+		float const * p = flock_positions(f);
+		size_t const stride = flock_stride(f);
+		for (int i = 0; i < n; ++i) {
+			float const * xy = (float const *)((char const *)p + (size_t)i * stride);
+			out[2 * i] = xy[0];
+			out[2 * i + 1] = xy[1];
+		}
+	}
+	flock_destroy(f);
+	return ok;
+}
+
+int main(void)
+{
+	enum { N = 500 };
+	static float one[2 * N], four[2 * N];
+
+	check(flock_api_version() == FLOCK_API_VERSION, "library matches the header version");
+	check(flock_create(-1, 800, 600, 1u) == NULL, "negative boid count rejected");
+	check(flock_create(10, 0, 600, 1u) == NULL, "empty world rejected");
+	check(flock_step(NULL, 0.1f, 1) == -1, "NULL handle rejected");
+	flock_destroy(NULL);
+
+	flock_t * f = flock_create(N, 800, 600, 7u);
+	check(f != NULL, "flock created");
+	if (f == NULL) {
+		return 1;
+	}
+	check(flock_count(f) == N, "boid count");
+	check(flock_stride(f) >= 4 * sizeof(float), "stride holds position and velocity");
+
+	float value = 0.0f;
+	check(flock_set_param(f, FLOCK_PARAM_MAX_SPEED, 3.0f) == 0
+	      && flock_get_param(f, FLOCK_PARAM_MAX_SPEED, &value) == 0 && value == 3.0f,
+	      "parameter round trip");
+	check(flock_set_param(f, FLOCK_PARAM_SEPARATION_WEIGHT, 2.0f) == 0
+	      && flock_get_param(f, FLOCK_PARAM_SEPARATION_RADIUS, &value) == 0 && value == 20.0f,
+	      "separation radius independent of its weight");
+	check(flock_set_param(f, (flock_param_t)99, 1.0f) == -1, "unknown parameter rejected");
+	check(flock_set_param(f, FLOCK_PARAM_COHESION_WEIGHT, -1.0f) == -1, "negative weight rejected");
+	check(flock_get_param(f, FLOCK_PARAM_MAX_FORCE, NULL) == -1, "NULL output rejected");
+
+	float const * positions = flock_positions(f);
+	float const before = positions[0];
+	check(flock_step(f, 0.1f, 10) == 0, "ten steps");
+	check(flock_positions(f) == positions && positions[0] != before, "state buffer updated in place");
+	check(flock_velocities(f) == positions + 2, "velocities follow positions");
+	flock_destroy(f);
+
+	check(run(1, one, N) && run(4, four, N) && memcmp(one, four, sizeof(one)) == 0,
+	      "deterministic state independent of threads");
+
+	return failures == 0 ? 0 : 1;
+}
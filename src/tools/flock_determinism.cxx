@@ -0,0 +1,140 @@
+// Golden-trajectory check for the deterministic update mode.
+//
+// Runs the same seeded flock with 1..N threads in deterministic mode and
+// checks that every run ends in a bitwise identical state. With --golden the
+// final state hash is also compared against (or, with --write-golden, saved
+// to) a reference file. Finally reports the cost of deterministic mode
+// against the fast mode.
+//
+// `make check` runs it through determinism_check.sh against the committed
+// flock_determinism.golden. Builds with FLOCK_FAST_MATH follow a different
+// trajectory, so there the golden comparison is skipped (exit status 77).
+//
+// usage: flock-determinism [--boids N] [--steps S] [--threads T]
+//                          [--golden FILE | --write-golden FILE]
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include "../model/flock.h"
+#include "../utility/job_system.h"
+
+int const WIDTH = 800;
+int const HEIGHT = 600;
+unsigned int const SEED = 2024u;
+float const DT = 0.1f;
+
+// FNV-1a over the raw bytes of every boid's state
+std::uint64_t hash_state(Flock const & flock) {
+	std::uint64_t h = 1469598103934665603ull;
+	for (Boid const & b : flock.get_boids()) {
+		unsigned char const * p = reinterpret_cast<unsigned char const *>(&b);
+		for (std::size_t k = 0; k < sizeof(Boid); ++k) {
+			h = (h ^ p[k]) * 1099511628211ull;
+		}
+	}
+	return h;
+}
+
+// Returns the seconds per step; stores the final state hash in `hash`
+double run(int boids, int steps, int threads, bool deterministic, std::uint64_t& hash) {
+	JobSystem jobs(threads);
+	Flock flock(boids, WIDTH, HEIGHT, SEED);
+	flock.set_job_system(&jobs);
+	flock.set_deterministic(deterministic);
+
+	auto start = std::chrono::steady_clock::now();
+	for (int s = 0; s < steps; ++s) {
+		flock.update(DT, WIDTH, HEIGHT);
+	}
+	std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+	hash = hash_state(flock);
+	return elapsed.count() / steps;
+}
+
+int main(int argc, char ** argv)
+{
+	int boids = 4000;
+	int steps = 200;
+	int max_threads = std::max(2u, std::thread::hardware_concurrency());
+	std::string golden, write_golden;
+
+	for (int i = 1; i < argc; ++i) {
+		std::string arg = argv[i];
+		if (arg == "--boids" && i + 1 < argc) {
+			boids = std::atoi(argv[++i]);
+		} else if (arg == "--steps" && i + 1 < argc) {
+			steps = std::atoi(argv[++i]);
+		} else if (arg == "--threads" && i + 1 < argc) {
+			max_threads = std::atoi(argv[++i]);
+		} else if (arg == "--golden" && i + 1 < argc) {
+			golden = argv[++i];
+		} else if (arg == "--write-golden" && i + 1 < argc) {
+			write_golden = argv[++i];
+		} else {
+			std::fprintf(stderr, "usage: %s [--boids N] [--steps S] [--threads T] [--golden FILE | --write-golden FILE]\n", argv[0]);
+			return 2;
+		}
+	}
+
+	bool ok = true;
+
+	// 1. Deterministic mode must not depend on the thread count
+	std::uint64_t reference = 0;
+	double det_time = 0.0;
+	for (int t = 1; t <= max_threads; ++t) {
+		std::uint64_t h;
+		double per_step = run(boids, steps, t, true, h);
+		if (t == 1) {
+			reference = h;
+		}
+		if (t == max_threads) {
+			det_time = per_step;
+		}
+		bool same = (h == reference);
+		ok = ok && same;
+		std::printf("deterministic threads=%2d  hash=%016llx  %8.3f ms/step  %s\n",
+				t, (unsigned long long)h, per_step * 1e3, same ? "ok" : "MISMATCH");
+	}
+
+	// 2. Golden trajectory
+	if (not write_golden.empty()) {
+		std::FILE * f = std::fopen(write_golden.c_str(), "w");
+		if (not f) {
+			std::perror(write_golden.c_str());
+			return 2;
+		}
+		std::fprintf(f, "%d %d %016llx\n", boids, steps, (unsigned long long)reference);
+		std::fclose(f);
+		std::printf("golden hash written to %s\n", write_golden.c_str());
+	} else if (not golden.empty()) {
+#ifdef FLOCK_FAST_MATH
+		std::printf("golden %s: skipped (approximate math changes the trajectory)\n", golden.c_str());
+		return ok ? 77 : 1;
+#endif
+		std::FILE * f = std::fopen(golden.c_str(), "r");
+		int g_boids = 0, g_steps = 0;
+		unsigned long long g_hash = 0;
+		if (not f || std::fscanf(f, "%d %d %llx", &g_boids, &g_steps, &g_hash) != 3) {
+			std::fprintf(stderr, "cannot read golden file %s\n", golden.c_str());
+			return 2;
+		}
+		std::fclose(f);
+		bool same = g_boids == boids && g_steps == steps && g_hash == reference;
+		ok = ok && same;
+		std::printf("golden %s: %s\n", golden.c_str(), same ? "ok" : "MISMATCH");
+	}
+
+	// 3. Cost compared with the fast mode at the same thread count
+	std::uint64_t fast_hash;
+	double fast_time = run(boids, steps, max_threads, false, fast_hash);
+	std::printf("fast          threads=%2d  %8.3f ms/step\n", max_threads, fast_time * 1e3);
+	std::printf("deterministic overhead: %+.1f%%\n", 100.0 * (det_time - fast_time) / fast_time);
+
+	return ok ? 0 : 1;
+}
@@ -0,0 +1,71 @@
+// Step-level check for multirate mode, run by `make check`.
+//
+// Places a packed cluster and a few isolated boids in one world and steps
+// it with multirate on. Every boid of the cluster has far more than
+// DENSE_NEIGHBORS neighbors inside the separation radius, so it must stay at
+// level 0 on every step; the isolated boids only feel the steady pull of
+// cohesion and must move up at least one level.
+
+#include <cmath>
+#include <cstdio>
+#include <vector>
+#include "../model/flock.h"
+
+int const WIDTH = 1000;
+int const HEIGHT = 1000;
+int const STEPS = 40;
+float const DT = 0.1f;
+
+static int failures = 0;
+
+static void check(bool ok, char const * what)
+{
+	std::printf("%-52s %s\n", what, ok ? "ok" : "FAILED");
+	if (not ok) {
+		failures++;
+	}
+}
+
+int main()
+{
+	std::vector<Boid> boids;
+
+	// 7 x 7 cluster, 3 units apart, around the center
+	int const SIDE = 7;
+	for (int y = 0; y < SIDE; ++y) {
+		for (int x = 0; x < SIDE; ++x) {
+			boids.emplace_back(Vec2{500.0f + 3.0f * (x - SIDE / 2), 500.0f + 3.0f * (y - SIDE / 2)}, Vec2{0.0f, 0.0f});
+		}
+	}
+	int const cluster = (int)boids.size();
+
+	// Isolated boids on a circle far from the cluster and from each other
+	int const ISOLATED = 8;
+	for (int k = 0; k < ISOLATED; ++k) {
+		float angle = 2.0f * 3.14159265f * k / ISOLATED;
+		boids.emplace_back(Vec2{500.0f + 400.0f * std::cos(angle), 500.0f + 400.0f * std::sin(angle)}, Vec2{0.0f, 0.0f});
+	}
+
+	Flock flock(0, WIDTH, HEIGHT, 1u);
+	flock.add_boids(boids.data(), boids.size());
+	flock.set_multirate(true);
+
+	bool cluster_at_zero = true;
+	for (int s = 0; s < STEPS; ++s) {
+		flock.update(DT, WIDTH, HEIGHT);
+		for (int i = 0; i < cluster; ++i) {
+			cluster_at_zero = cluster_at_zero && flock.get_step_level(i) == 0;
+		}
+	}
+
+	bool isolated_raised = true;
+	for (int i = cluster; i < cluster + ISOLATED; ++i) {
+		isolated_raised = isolated_raised && flock.get_step_level(i) > 0;
+	}
+
+	check(cluster_at_zero, "packed cluster stays at level 0");
+	check(isolated_raised, "isolated boids move up a level");
+	check(flock.get_evaluated_fraction() < 1.0, "isolated boids skip evaluations");
+
+	return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,198 @@
+// Hysteresis check for the adaptive quality controller, run by `make check`.
+//
+// Feeds utility/quality_controller.h synthetic frame timings (no SDL, no
+// simulation) and checks that it stays put at a steady load between its two
+// thresholds, degrades in the documented order for simulation-bound and
+// render-bound frames, restores in reverse order, and backs off after
+// upgrades that have to be reverted.
+
+#include <cstdio>
+#include <functional>
+#include <string>
+#include <vector>
+#include "../utility/quality_controller.h"
+
+typedef QualityController::State State;
+
+// Returns {update_ms, render_ms} for a frame rendered at the given state
+typedef std::function<void(State const &, double&, double&)> load_t;
+
+struct change_t {
+	int frame;
+	std::string what;
+	int backoff;
+};
+
+static int failures = 0;
+
+static void check(bool ok, char const * what)
+{
+	std::printf("%-52s %s\n", what, ok ? "ok" : "FAILED");
+	if (not ok) {
+		failures++;
+	}
+}
+
+// Describes the setting that differs between two states
+static std::string describe(State const & from, State const & to)
+{
+	if (to.substeps != from.substeps) {
+		return "substeps " + std::to_string(to.substeps);
+	}
+	if (to.lod != from.lod) {
+		return std::string("lod ") + QualityController::lod_name(to.lod);
+	}
+	return "boids " + std::to_string(to.active_boids);
+}
+
+// Runs `frames` frames under `load` and returns the changes it caused
+static std::vector<change_t> run(QualityController& q, int frames, load_t const & load)
+{
+	std::vector<change_t> changes;
+	for (int f = 0; f < frames; ++f) {
+		State const before = q.get_state();
+		double update_ms = 0.0, render_ms = 0.0;
+		load(before, update_ms, render_ms);
+		if (q.record(update_ms, render_ms)) {
+			changes.push_back(change_t{f, describe(before, q.get_state()), q.get_backoff()});
+		}
+	}
+	return changes;
+}
+
+static bool same(std::vector<change_t> const & changes, std::vector<std::string> const & expected)
+{
+	if (changes.size() != expected.size()) {
+		return false;
+	}
+	for (std::size_t k = 0; k < expected.size(); ++k) {
+		if (changes[k].what != expected[k]) {
+			return false;
+		}
+	}
+	return true;
+}
+
+// Budget 10 ms: degrade above 9.5 ms, improve below 6 ms
+static QualityController::Config make_config()
+{
+	QualityController::Config c;
+	c.budget_ms = 10.0;
+	c.max_substeps = 3;
+	c.scale_boids = true;
+	c.max_boids = 1000;
+	c.min_boids = 100;
+	return c;
+}
+
+static void light(State const &, double& update_ms, double& render_ms)
+{
+	update_ms = 2.0;
+	render_ms = 1.0;
+}
+
+int main()
+{
+	// 1. Steady load between the thresholds, with frame-to-frame jitter
+	{
+		QualityController q(make_config());
+		unsigned int seed = 1u;
+		std::vector<change_t> changes = run(q, 5000, [&](State const &, double& u, double& r) {
+			seed = seed * 1103515245u + 12345u;
+			double jitter = (double)((seed >> 16) % 1000) / 1000.0; // [0, 1)
+			u = 4.0 + 2.0 * jitter; // Frames of 6.5 .. 8.5 ms
+			r = 2.5;
+		});
+		check(changes.empty(), "steady load between thresholds: no change");
+	}
+
+	// 2. A level that overshoots and one that fits: settle once, no way back up
+	{
+		QualityController q(make_config());
+		run(q, 1000, light);
+		std::vector<change_t> changes = run(q, 5000, [](State const & s, double& u, double& r) {
+			u = 3.5 * s.substeps; // 3 substeps: 11.5 ms, 2 substeps: 8 ms
+			r = 1.0;
+		});
+		check(same(changes, {"substeps 2"}), "one downgrade, then stable between thresholds");
+	}
+
+	// 3. Simulation-bound: substeps, then detail, then boids; restore in reverse
+	{
+		QualityController q(make_config());
+		check(same(run(q, 1000, light), {"substeps 2", "substeps 3"}), "light load raises substeps up to max_substeps");
+
+		std::vector<change_t> down = run(q, 2000, [](State const &, double& u, double& r) {
+			u = 30.0;
+			r = 1.0;
+		});
+		bool order = down.size() > 4
+		          && same(std::vector<change_t>(down.begin(), down.begin() + 4),
+		                  {"substeps 2", "substeps 1", "lod points", "lod heatmap"});
+		for (std::size_t k = 4; k < down.size(); ++k) {
+			order = order && down[k].what.compare(0, 6, "boids ") == 0;
+		}
+		check(order, "sim-bound: substeps, then lod, then boids");
+		check(q.get_state().active_boids == 100, "boids stop at min_boids");
+
+		std::vector<change_t> up = run(q, 3000, light);
+		std::size_t boids = 0;
+		while (boids < up.size() && up[boids].what.compare(0, 6, "boids ") == 0) {
+			boids++;
+		}
+		bool reverse = boids > 0 && up[boids - 1].what == "boids 1000"
+		            && same(std::vector<change_t>(up.begin() + boids, up.end()),
+		                    {"lod points", "lod triangles", "substeps 2", "substeps 3"});
+		check(reverse, "restore: boids, then lod, then substeps");
+	}
+
+	// 4. Render-bound: detail first, then substeps, then boids
+	{
+		QualityController q(make_config());
+		run(q, 1000, light);
+		std::vector<change_t> down = run(q, 2000, [](State const &, double& u, double& r) {
+			u = 1.0;
+			r = 30.0;
+		});
+		bool order = down.size() > 5
+		          && same(std::vector<change_t>(down.begin(), down.begin() + 5),
+		                  {"lod points", "lod heatmap", "substeps 2", "substeps 1", "boids 750"});
+		check(order, "render-bound: lod, then substeps, then boids");
+	}
+
+	// 5. Backoff: triangles never fit, points do. Each quick revert doubles
+	// the wait before the next upgrade, up to MAX_BACKOFF.
+	{
+		QualityController::Config c = make_config();
+		c.max_substeps = 1;
+		c.scale_boids = false;
+		QualityController q(c);
+		std::vector<change_t> changes = run(q, 20000, [](State const & s, double& u, double& r) {
+			u = 2.0;
+			r = s.lod == QualityController::Lod::TRIANGLES ? 10.0 : 1.0;
+		});
+
+		std::vector<int> backoffs;
+		bool waited = true;
+		for (std::size_t k = 0; k < changes.size(); ++k) {
+			if (changes[k].what != "lod points") {
+				continue;
+			}
+			backoffs.push_back(changes[k].backoff);
+			if (k + 1 < changes.size()) {
+				// The next upgrade comes no earlier than hold_frames * backoff
+				waited = waited && changes[k + 1].frame - changes[k].frame >= c.hold_frames * changes[k].backoff;
+			}
+		}
+		std::vector<int> const expected = {1, 2, 4, 8, QualityController::MAX_BACKOFF, QualityController::MAX_BACKOFF};
+		bool doubling = backoffs.size() >= expected.size();
+		for (std::size_t k = 0; doubling && k < backoffs.size(); ++k) {
+			int want = k < expected.size() ? expected[k] : QualityController::MAX_BACKOFF;
+			doubling = backoffs[k] == want;
+		}
+		check(doubling, "reverted upgrades double the backoff up to the cap");
+		check(waited, "upgrades wait hold_frames * backoff");
+	}
+
+	return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,172 @@
+// Reader for the shared-memory state ring written by `ant-war --publish NAME`.
+//
+// Maps the ring read-only, follows the newest frame and consumes each one in
+// place (a centroid over all records), validating it with the slot's
+// seqlock. Reports the end-to-end latency from publication to consumption,
+// frames skipped because the reader fell behind, and torn reads that had to
+// be retried.
+//
+// --timeout bounds both the wait for the ring to appear and the wait for each
+// new frame, so a publisher that died without closing the ring ends the run.
+//
+// usage: state-reader [--name NAME] [--frames N] [--timeout SECONDS]
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "../utility/state_publisher.h"
+
+using namespace state_ring;
+
+// Maps the ring once the publisher has created and initialized it
+void * open_ring(std::string const & name, double timeout, std::size_t& bytes) {
+	auto deadline = std::chrono::steady_clock::now() + std::chrono::duration<double>(timeout);
+	while (std::chrono::steady_clock::now() < deadline) {
+		int fd = shm_open(name.c_str(), O_RDONLY, 0);
+		if (fd >= 0) {
+			struct stat st;
+			if (fstat(fd, &st) == 0 && (std::size_t)st.st_size >= sizeof(RingHeader)) {
+				bytes = (std::size_t)st.st_size;
+				void * map = mmap(nullptr, bytes, PROT_READ, MAP_SHARED, fd, 0);
+				close(fd);
+				if (map == MAP_FAILED) {
+					return nullptr;
+				}
+				RingHeader const * h = static_cast<RingHeader const *>(map);
+				if (h->magic == MAGIC) {
+					std::atomic_thread_fence(std::memory_order_acquire);
+					return map;
+				}
+				munmap(map, bytes);
+			} else {
+				close(fd);
+			}
+		}
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	}
+	return nullptr;
+}
+
+int main(int argc, char ** argv)
+{
+	std::string name = "/ant-war";
+	long frames = 1000;
+	double timeout = 10.0;
+
+	for (int i = 1; i < argc; ++i) {
+		std::string arg = argv[i];
+		if (arg == "--name" && i + 1 < argc) {
+			name = argv[++i];
+		} else if (arg == "--frames" && i + 1 < argc) {
+			frames = std::atol(argv[++i]);
+		} else if (arg == "--timeout" && i + 1 < argc) {
+			timeout = std::atof(argv[++i]);
+		} else {
+			std::fprintf(stderr, "usage: %s [--name NAME] [--frames N] [--timeout SECONDS]\n", argv[0]);
+			return 1;
+		}
+	}
+
+	std::size_t bytes = 0;
+	void * base = open_ring(name, timeout, bytes);
+	if (!base) {
+		std::fprintf(stderr, "no state ring at %s\n", name.c_str());
+		return 1;
+	}
+	RingHeader * h = static_cast<RingHeader *>(base);
+	if (h->version != VERSION || h->record_bytes != sizeof(BoidRecord)
+	    || h->header_bytes + (std::uint64_t)h->slot_count * h->slot_bytes > bytes) {
+		std::fprintf(stderr, "incompatible state ring (version %u, expected %u)\n", h->version, VERSION);
+		return 1;
+	}
+	std::printf("ring %s: %u slots of %u boids, world %.0fx%.0f\n", name.c_str(),
+	            h->slot_count, h->max_boids, h->world_width, h->world_height);
+
+	std::vector<double> latency_us;
+	latency_us.reserve(frames > 0 ? frames : 0);
+	std::uint64_t last = 0;
+	std::uint64_t skipped = 0;
+	std::uint64_t torn = 0;
+	double checksum = 0.0;
+	bool stalled = false;
+
+	auto const patience = std::chrono::duration<double>(timeout);
+	std::uint64_t seen = h->latest.load(std::memory_order_acquire);
+	auto last_advance = std::chrono::steady_clock::now();
+
+	while ((long)latency_us.size() < frames) {
+		std::uint64_t frame = h->latest.load(std::memory_order_acquire);
+		if (frame != seen) {
+			seen = frame;
+			last_advance = std::chrono::steady_clock::now();
+		}
+		if (frame == last) {
+			if (!h->publisher_alive.load(std::memory_order_acquire)) {
+				break;
+			}
+			if (std::chrono::steady_clock::now() - last_advance > patience) {
+				// The publisher crashed or hangs without having closed the ring
+				std::fprintf(stderr, "no new frame for %g s, giving up\n", timeout);
+				stalled = true;
+				break;
+			}
+			std::this_thread::yield();
+			continue;
+		}
+
+		SlotHeader * slot = slot_at(base, frame);
+		std::uint64_t seq = slot->sequence.load(std::memory_order_acquire);
+		if (seq != 2 * frame) {
+			// Already being overwritten by a newer frame
+			torn++;
+			continue;
+		}
+
+		// Consume in place, then check that the writer did not touch the slot meanwhile
+		std::uint32_t count = std::min(slot->count, h->max_boids);
+		std::int64_t published = slot->publish_ns;
+		BoidRecord const * r = records_of(slot);
+		float cx = 0.0f, cy = 0.0f;
+		for (std::uint32_t i = 0; i < count; ++i) {
+			cx += r[i].px;
+			cy += r[i].py;
+		}
+		std::atomic_thread_fence(std::memory_order_acquire);
+		if (slot->sequence.load(std::memory_order_relaxed) != seq) {
+			torn++;
+			continue;
+		}
+		std::int64_t now = monotonic_ns();
+
+		if (last != 0 && frame > last + 1) {
+			skipped += frame - last - 1;
+		}
+		last = frame;
+		checksum += count > 0 ? (cx + cy) / count : 0.0f;
+		latency_us.push_back((now - published) * 1e-3);
+	}
+
+	munmap(base, bytes);
+	if (latency_us.empty()) {
+		std::printf("no frames received\n");
+		return 1;
+	}
+
+	std::sort(latency_us.begin(), latency_us.end());
+	auto pct = [&](double p) { return latency_us[(std::size_t)(p * (latency_us.size() - 1))]; };
+	std::printf("%zu frames, %llu skipped, %llu torn reads retried (checksum %g)\n",
+	            latency_us.size(), (unsigned long long)skipped, (unsigned long long)torn, checksum);
+	std::printf("latency us: min %.1f  p50 %.1f  p99 %.1f  max %.1f\n",
+	            latency_us.front(), pct(0.5), pct(0.99), latency_us.back());
+	return stalled ? 1 : 0;
+}
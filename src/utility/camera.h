@@ -0,0 +1,97 @@
+#pragma once
+
+#include <algorithm>
+#include "../model/vec2.h"
+
+/**
+ * @brief Maps a rectangle of the world onto the window (pan + uniform zoom).
+ * * The world can be much larger than the window: `center` is the world point
+ * shown in the middle of the viewport and `zoom` is screen pixels per world
+ * unit. Rendering uses visible_rect() to query only the boids in view.
+ */
+struct Camera {
+    float world_width;
+    float world_height;
+    int view_width;
+    int view_height;
+
+    Vec2 center;
+    float zoom = 1.0f;
+    float min_zoom = 1e-4f;
+    float max_zoom = 64.0f;
+
+    Camera(float world_w, float world_h, int view_w, int view_h)
+        : world_width(world_w), world_height(world_h), view_width(view_w), view_height(view_h),
+          center(world_w * 0.5f, world_h * 0.5f) {}
+
+    // --- Transforms ---
+
+    Vec2 world_to_screen(const Vec2& p) const {
+        return Vec2{(p.x - center.x) * zoom + view_width * 0.5f,
+                    (p.y - center.y) * zoom + view_height * 0.5f};
+    }
+
+    Vec2 screen_to_world(const Vec2& s) const {
+        return Vec2{(s.x - view_width * 0.5f) / zoom + center.x,
+                    (s.y - view_height * 0.5f) / zoom + center.y};
+    }
+
+    /**
+     * @brief World-space bounds of the viewport, grown by `margin` world units.
+     */
+    void visible_rect(float margin, float& x0, float& y0, float& x1, float& y1) const {
+        float half_w = view_width * 0.5f / zoom + margin;
+        float half_h = view_height * 0.5f / zoom + margin;
+        x0 = center.x - half_w;
+        y0 = center.y - half_h;
+        x1 = center.x + half_w;
+        y1 = center.y + half_h;
+    }
+
+    // --- Controls ---
+
+    /**
+     * @brief Moves the view by a distance given in screen pixels.
+     */
+    void pan(float dx_pixels, float dy_pixels) {
+        center.x += dx_pixels / zoom;
+        center.y += dy_pixels / zoom;
+        clamp_center();
+    }
+
+    /**
+     * @brief Multiplies the zoom by `factor`, keeping the world point under
+     * the given screen position fixed (e.g. the mouse cursor).
+     */
+    void zoom_at(float factor, const Vec2& screen_anchor) {
+        Vec2 anchor = screen_to_world(screen_anchor);
+        zoom = std::min(std::max(zoom * factor, min_zoom), max_zoom);
+        // Shift so the anchor maps back to the same screen position
+        Vec2 moved = screen_to_world(screen_anchor);
+        center += anchor - moved;
+        clamp_center();
+    }
+
+    /**
+     * @brief Zooms out so the whole world fits in the viewport.
+     */
+    void fit_world() {
+        zoom = std::min(view_width / world_width, view_height / world_height);
+        zoom = std::min(std::max(zoom, min_zoom), max_zoom);
+        center = Vec2{world_width * 0.5f, world_height * 0.5f};
+    }
+
+    /**
+     * @brief Updates the viewport size after a window resize.
+     */
+    void resize(int view_w, int view_h) {
+        view_width = view_w;
+        view_height = view_h;
+    }
+
+private:
+    void clamp_center() {
+        center.x = std::min(std::max(center.x, 0.0f), world_width);
+        center.y = std::min(std::max(center.y, 0.0f), world_height);
+    }
+};
@@ -0,0 +1,266 @@
+#include "frame_exporter.h"
+#include <algorithm>
+#include <signal.h>
+
+FrameExporter::FrameExporter(std::string const & target, Format format, int width, int height,
+                             int fps, std::size_t pool_size)
+    : target(target), format(format), width(width), height(height), fps(fps) {
+
+    // Open the output up front so a bad path is reported before recording starts
+    switch (format) {
+        case Format::RAW:
+        case Format::Y4M:
+            this->out = std::fopen(target.c_str(), "wb");
+            this->failed = (this->out == nullptr);
+            break;
+        case Format::PIPE:
+            // Only the writer thread writes to the pipe, with SIGPIPE blocked (see run())
+            this->out = popen(target.c_str(), "w");
+            this->failed = (this->out == nullptr);
+            break;
+        case Format::PPM:
+            // One file per frame, opened by the writer
+            this->failed = not this->parse_pattern(target);
+            break;
+    }
+
+    if (format == Format::Y4M && this->out) {
+        std::fprintf(this->out, "YUV4MPEG2 W%d H%d F%d:1 Ip A1:1 C420jpeg\n", width, height, fps);
+    }
+
+    if (pool_size == 0) {
+        pool_size = 1;
+    }
+    this->pool.resize(pool_size);
+    for (std::vector<std::uint8_t>& buffer : this->pool) {
+        buffer.resize((std::size_t)this->pitch() * height);
+        this->free_list.push_back(buffer.data());
+    }
+
+    this->writer = std::thread(&FrameExporter::run, this);
+}
+
+FrameExporter::~FrameExporter() {
+    this->finish();
+}
+
+bool FrameExporter::finish() {
+    if (this->writer.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(this->mutex);
+            this->stopping = true;
+        }
+        this->wake.notify_all();
+        // The writer closes the output once the queue is drained
+        this->writer.join();
+    }
+    return this->is_ok();
+}
+
+bool FrameExporter::close_output() {
+    if (not this->out) {
+        return true;
+    }
+    // pclose reports the encoder's exit status
+    int status = this->format == Format::PIPE ? pclose(this->out) : std::fclose(this->out);
+    this->out = nullptr;
+    return status == 0;
+}
+
+bool FrameExporter::parse_pattern(std::string const & pattern) {
+    // Exactly one %d / %i / %u conversion, optionally zero-padded to a width;
+    // "%%" is a literal percent. The pattern itself is never used as a format.
+    bool found = false;
+    std::string* piece = &this->name_prefix;
+    for (std::size_t k = 0; k < pattern.size(); ++k) {
+        if (pattern[k] != '%') {
+            *piece += pattern[k];
+            continue;
+        }
+        if (++k < pattern.size() && pattern[k] == '%') {
+            *piece += '%';
+            continue;
+        }
+        if (found) {
+            return false;
+        }
+        if (k < pattern.size() && pattern[k] == '0') {
+            this->name_zero_pad = true;
+            ++k;
+        }
+        while (k < pattern.size() && pattern[k] >= '0' && pattern[k] <= '9' && this->name_width < 100) {
+            this->name_width = this->name_width * 10 + (pattern[k++] - '0');
+        }
+        if (k >= pattern.size() || (pattern[k] != 'd' && pattern[k] != 'i' && pattern[k] != 'u')) {
+            return false;
+        }
+        found = true;
+        piece = &this->name_suffix;
+    }
+    return found;
+}
+
+bool FrameExporter::is_ok() const {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    return not this->failed;
+}
+
+std::uint8_t * FrameExporter::acquire() {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    if (this->free_list.empty() || this->failed) {
+        this->stats.dropped++;
+        return nullptr;
+    }
+    std::uint8_t * frame = this->free_list.back();
+    this->free_list.pop_back();
+    return frame;
+}
+
+void FrameExporter::submit(std::uint8_t * frame) {
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->queue.push_back(frame);
+        this->stats.submitted++;
+    }
+    this->wake.notify_one();
+}
+
+void FrameExporter::release(std::uint8_t * frame) {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    this->free_list.push_back(frame);
+}
+
+FrameExporter::Stats FrameExporter::get_stats() const {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    return this->stats;
+}
+
+bool FrameExporter::parse_format(std::string const & name, Format& format) {
+    if (name == "raw") { format = Format::RAW; return true; }
+    if (name == "y4m") { format = Format::Y4M; return true; }
+    if (name == "ppm") { format = Format::PPM; return true; }
+    if (name == "pipe") { format = Format::PIPE; return true; }
+    return false;
+}
+
+// --- Writer Thread ---
+
+void FrameExporter::run() {
+    if (this->format == Format::PIPE) {
+        // A crashed encoder must turn into a write error (EPIPE), not kill the
+        // process. Blocking SIGPIPE on this thread only leaves the process-wide
+        // handling alone; every write to the pipe, including the flush in
+        // pclose, happens here. A pending SIGPIPE is discarded with the thread.
+        sigset_t pipe_signal;
+        sigemptyset(&pipe_signal);
+        sigaddset(&pipe_signal, SIGPIPE);
+        pthread_sigmask(SIG_BLOCK, &pipe_signal, nullptr);
+    }
+
+    std::unique_lock<std::mutex> lock(this->mutex);
+    for (;;) {
+        this->wake.wait(lock, [this] { return this->stopping || not this->queue.empty(); });
+        if (this->queue.empty()) {
+            // Stopping and fully drained
+            lock.unlock();
+            bool closed = this->close_output();
+            lock.lock();
+            this->failed = this->failed || not closed;
+            return;
+        }
+
+        std::uint8_t * frame = this->queue.front();
+        this->queue.pop_front();
+
+        // Encode and write without holding the lock so the render loop never waits on I/O
+        lock.unlock();
+        bool ok = this->write_frame(frame);
+        lock.lock();
+
+        this->free_list.push_back(frame);
+        if (ok) {
+            this->stats.written++;
+        } else {
+            this->failed = true;
+        }
+    }
+}
+
+bool FrameExporter::write_frame(std::uint8_t const * frame) {
+    std::size_t const size = (std::size_t)this->pitch() * this->height;
+
+    switch (this->format) {
+        case Format::RAW:
+        case Format::PIPE:
+            // An encoder that exited shows up as a short write with errno EPIPE;
+            // the exporter is then marked failed and stops taking frames
+            return this->out && std::fwrite(frame, 1, size, this->out) == size;
+
+        case Format::Y4M:
+            return this->write_y4m(frame);
+
+        case Format::PPM: {
+            char number[128];
+            std::snprintf(number, sizeof(number), this->name_zero_pad ? "%0*llu" : "%*llu",
+                          this->name_width, (unsigned long long)this->frame_index++);
+            std::string path = this->name_prefix + number + this->name_suffix;
+            std::FILE * f = std::fopen(path.c_str(), "wb");
+            if (not f) {
+                return false;
+            }
+            std::fprintf(f, "P6\n%d %d\n255\n", this->width, this->height);
+            bool ok = std::fwrite(frame, 1, size, f) == size;
+            return std::fclose(f) == 0 && ok;
+        }
+    }
+    return false;
+}
+
+bool FrameExporter::write_y4m(std::uint8_t const * frame) {
+    if (not this->out) {
+        return false;
+    }
+
+    int const w = this->width;
+    int const h = this->height;
+    int const cw = (w + 1) / 2;
+    int const ch = (h + 1) / 2;
+    this->yuv.resize((std::size_t)w * h + 2 * (std::size_t)cw * ch);
+
+    std::uint8_t * y_plane = this->yuv.data();
+    std::uint8_t * u_plane = y_plane + (std::size_t)w * h;
+    std::uint8_t * v_plane = u_plane + (std::size_t)cw * ch;
+
+    // Full-range BT.601 (JPEG) coefficients in 8.8 fixed point
+    for (int j = 0; j < h; ++j) {
+        std::uint8_t const * row = frame + (std::size_t)j * this->pitch();
+        for (int i = 0; i < w; ++i) {
+            int r = row[3*i], g = row[3*i+1], b = row[3*i+2];
+            y_plane[j*w+i] = (std::uint8_t)((77*r + 150*g + 29*b + 128) >> 8);
+        }
+    }
+
+    // Chroma is averaged over each 2x2 block (clamped at odd edges)
+    for (int j = 0; j < ch; ++j) {
+        for (int i = 0; i < cw; ++i) {
+            int r = 0, g = 0, b = 0;
+            for (int dj = 0; dj < 2; ++dj) {
+                int y = 2*j + dj < h ? 2*j + dj : h - 1;
+                for (int di = 0; di < 2; ++di) {
+                    int x = 2*i + di < w ? 2*i + di : w - 1;
+                    std::uint8_t const * p = frame + (std::size_t)y * this->pitch() + 3*x;
+                    r += p[0]; g += p[1]; b += p[2];
+                }
+            }
+            r /= 4; g /= 4; b /= 4;
+            // Pure blue (U) and pure red (V) come out at 256: clamp before narrowing
+            int u = (-43*r - 85*g + 128*b + 128*256 + 128) >> 8;
+            int v = (128*r - 107*g - 21*b + 128*256 + 128) >> 8;
+            u_plane[j*cw+i] = (std::uint8_t)std::min(std::max(u, 0), 255);
+            v_plane[j*cw+i] = (std::uint8_t)std::min(std::max(v, 0), 255);
+        }
+    }
+
+    return std::fputs("FRAME\n", this->out) >= 0
+        && std::fwrite(this->yuv.data(), 1, this->yuv.size(), this->out) == this->yuv.size();
+}
@@ -0,0 +1,133 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief Writes rendered frames to disk (or to an encoder process) on a background thread.
+ * * The render loop acquires a buffer from a fixed pool, reads the frame into it
+ * and submits it. Encoding and file I/O happen on the exporter's own thread.
+ * The queue is bounded by the pool size: when the writer falls behind,
+ * acquire() returns nullptr and the frame is dropped instead of blocking the
+ * simulation.
+ * * Frames are packed RGB24 (width * 3 bytes per row, no padding).
+ * * SDL2 has no asynchronous readback: SDL_RenderReadPixels always copies
+ * synchronously. The caller should read a frame back once the GPU has
+ * finished it (e.g. at the start of the next frame, before drawing), so the
+ * copy does not wait for rendering that was just submitted.
+ */
+class FrameExporter {
+public:
+    enum class Format {
+        RAW,    // Headerless RGB24 stream in a single file
+        Y4M,    // YUV4MPEG2 (4:2:0) stream, playable by most video tools
+        PPM,    // One binary PPM image per frame; target is a pattern like "frame_%05d.ppm"
+        PIPE    // Raw RGB24 piped to the stdin of a shell command (e.g. ffmpeg); SIGPIPE is blocked on the writer thread
+    };
+
+    struct Stats {
+        std::uint64_t submitted = 0; // Frames handed to the writer
+        std::uint64_t written = 0;   // Frames fully written
+        std::uint64_t dropped = 0;   // Frames skipped because the pool was exhausted
+    };
+
+    /**
+     * @brief Opens the output and starts the writer thread.
+     * @param target Output file, PPM filename pattern or shell command depending on format.
+     * @param format Output format.
+     * @param width Frame width in pixels.
+     * @param height Frame height in pixels.
+     * @param fps Frame rate written to the Y4M header.
+     * @param pool_size Number of reusable frame buffers (also the maximum queue depth).
+     */
+    FrameExporter(std::string const & target, Format format, int width, int height,
+                  int fps = 50, std::size_t pool_size = 8);
+
+    /**
+     * @brief Calls finish() if it was not called yet.
+     */
+    ~FrameExporter();
+
+    /**
+     * @brief Flushes every queued frame, stops the writer and closes the output.
+     * @return True if every frame was written and the file closed (or the
+     * encoder process exited) without error.
+     */
+    bool finish();
+
+    FrameExporter(FrameExporter const &) = delete;
+    FrameExporter& operator=(FrameExporter const &) = delete;
+
+    /**
+     * @brief True if the output could be opened and no write error occurred.
+     */
+    bool is_ok() const;
+
+    /**
+     * @brief Takes a free buffer from the pool without blocking.
+     * @return A buffer of pitch() * height bytes, or nullptr if all are in flight.
+     */
+    std::uint8_t * acquire();
+
+    /**
+     * @brief Queues a buffer obtained from acquire() for writing.
+     */
+    void submit(std::uint8_t * frame);
+
+    /**
+     * @brief Returns a buffer obtained from acquire() to the pool without writing it.
+     */
+    void release(std::uint8_t * frame);
+
+    int pitch() const { return this->width * 3; }
+    int get_width() const { return this->width; }
+    int get_height() const { return this->height; }
+
+    Stats get_stats() const;
+
+    /**
+     * @brief Parses "raw", "y4m", "ppm" or "pipe". Returns false on an unknown name.
+     */
+    static bool parse_format(std::string const & name, Format& format);
+
+private:
+    void run();
+    bool close_output();
+    bool write_frame(std::uint8_t const * frame);
+    bool parse_pattern(std::string const & pattern);
+    bool write_y4m(std::uint8_t const * frame);
+
+    std::string target;
+    Format format;
+    int width;
+    int height;
+    int fps;
+
+    std::FILE * out = nullptr;
+    std::uint64_t frame_index = 0; // Only touched by the writer thread
+
+    // PPM file names: prefix, zero-padded (or space-padded) frame number, suffix
+    std::string name_prefix;
+    std::string name_suffix;
+    int name_width = 0;
+    bool name_zero_pad = false;
+    std::vector<std::uint8_t> yuv; // Y4M conversion scratch, writer thread only
+
+    std::vector<std::vector<std::uint8_t>> pool;
+    std::vector<std::uint8_t *> free_list;
+    std::deque<std::uint8_t *> queue;
+
+    mutable std::mutex mutex;
+    std::condition_variable wake;
+    bool stopping = false;
+    bool failed = false;
+    Stats stats;
+
+    std::thread writer;
+};
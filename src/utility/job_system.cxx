@@ -0,0 +1,244 @@
+#include "job_system.h"
+#include <algorithm>
+#include <chrono>
+
+// Worker slot of the current thread; threads the scheduler did not start use slot 0
+static thread_local int tls_worker = 0;
+
+struct JobSystem::ForLoop {
+    std::function<void(int, int)> body;
+    int grain;
+    std::atomic<int> outstanding{1}; // Ranges not finished yet (the root counts as one)
+};
+
+JobSystem::JobSystem(int threads) {
+    if (threads <= 0) {
+        threads = std::max(1, (int)std::thread::hardware_concurrency());
+    }
+    for (int i = 0; i < threads; ++i) {
+        this->workers.emplace_back(new Worker());
+    }
+    for (int i = 1; i < threads; ++i) {
+        this->threads.emplace_back(&JobSystem::worker_main, this, i);
+    }
+}
+
+JobSystem::~JobSystem() {
+    {
+        std::lock_guard<std::mutex> lock(this->sleep_lock);
+        this->stopping = true;
+    }
+    this->sleep_cv.notify_all();
+    for (std::thread& t : this->threads) {
+        t.join();
+    }
+}
+
+int JobSystem::current_worker() {
+    return tls_worker;
+}
+
+// --- Task Graph ---
+
+JobSystem::TaskRef JobSystem::create(std::function<void()> fn) {
+    TaskRef task = std::make_shared<Task>();
+    task->fn = std::move(fn);
+    return task;
+}
+
+void JobSystem::depend(TaskRef const & task, TaskRef const & before) {
+    std::lock_guard<std::mutex> lock(before->lock);
+    if (before->done) {
+        return;
+    }
+    task->pending++;
+    before->successors.push_back(task);
+}
+
+void JobSystem::submit(TaskRef const & task) {
+    // Drop the submission reference; the last dependency to finish enqueues it
+    if (--task->pending == 0) {
+        this->push(task);
+    }
+}
+
+void JobSystem::wait(TaskRef const & task) {
+    int const index = tls_worker;
+    while (!task->done.load(std::memory_order_acquire)) {
+        if (!this->run_one(index)) {
+            std::this_thread::yield();
+        }
+    }
+}
+
+// --- Data Parallelism ---
+
+void JobSystem::parallel_for(int begin, int end, std::function<void(int, int)> body, int grain) {
+    if (end <= begin) {
+        return;
+    }
+    int const n = end - begin;
+    if (this->workers.size() == 1 || n == 1) {
+        body(begin, end);
+        return;
+    }
+
+    std::shared_ptr<ForLoop> loop = std::make_shared<ForLoop>();
+    loop->body = std::move(body);
+    // Default: up to 8 pieces per thread, enough slack for uneven costs
+    loop->grain = grain > 0 ? grain : std::max(1, n / (8 * (int)this->workers.size()));
+
+    this->run_range(loop, begin, end);
+
+    int const index = tls_worker;
+    while (loop->outstanding.load(std::memory_order_acquire) != 0) {
+        if (!this->run_one(index)) {
+            std::this_thread::yield();
+        }
+    }
+}
+
+void JobSystem::run_range(std::shared_ptr<ForLoop> const & loop, int begin, int end) {
+    Worker& self = *this->workers[tls_worker];
+
+    while (end - begin > loop->grain) {
+        {
+            // Enough work is already exposed; keep the rest as one chunk
+            std::lock_guard<std::mutex> lock(self.lock);
+            if (self.queue.size() >= 2) {
+                break;
+            }
+        }
+        int mid = begin + (end - begin) / 2;
+        int right_end = end;
+        loop->outstanding++;
+        std::shared_ptr<ForLoop> shared = loop;
+        TaskRef right = this->create([this, shared, mid, right_end] {
+            this->run_range(shared, mid, right_end);
+        });
+        right->pending = 0;
+        this->push(right);
+        end = mid;
+    }
+
+    loop->body(begin, end);
+    loop->outstanding.fetch_sub(1, std::memory_order_acq_rel);
+}
+
+// --- Scheduling ---
+
+void JobSystem::push(TaskRef const & task) {
+    Worker& self = *this->workers[tls_worker];
+    {
+        std::lock_guard<std::mutex> lock(self.lock);
+        self.queue.push_back(task);
+    }
+    this->queued++;
+    {
+        // Taking the lock orders this with a worker checking the predicate
+        std::lock_guard<std::mutex> lock(this->sleep_lock);
+    }
+    this->sleep_cv.notify_one();
+}
+
+JobSystem::TaskRef JobSystem::pop_local(int index) {
+    Worker& self = *this->workers[index];
+    std::lock_guard<std::mutex> lock(self.lock);
+    if (self.queue.empty()) {
+        return TaskRef();
+    }
+    TaskRef task = std::move(self.queue.back());
+    self.queue.pop_back();
+    return task;
+}
+
+JobSystem::TaskRef JobSystem::steal(int index) {
+    int const n = (int)this->workers.size();
+    for (int k = 1; k < n; ++k) {
+        Worker& victim = *this->workers[(index + k) % n];
+        std::lock_guard<std::mutex> lock(victim.lock);
+        if (!victim.queue.empty()) {
+            // Oldest task: usually the largest remaining range
+            TaskRef task = std::move(victim.queue.front());
+            victim.queue.pop_front();
+            this->workers[index]->steals.fetch_add(1, std::memory_order_relaxed);
+            return task;
+        }
+    }
+    this->workers[index]->failed_steals.fetch_add(1, std::memory_order_relaxed);
+    return TaskRef();
+}
+
+bool JobSystem::run_one(int index) {
+    TaskRef task = this->pop_local(index);
+    if (!task) {
+        task = this->steal(index);
+    }
+    if (!task) {
+        return false;
+    }
+    this->queued--;
+    this->execute(task, index);
+    return true;
+}
+
+void JobSystem::execute(TaskRef const & task, int index) {
+    task->fn();
+    this->workers[index]->executed.fetch_add(1, std::memory_order_relaxed);
+
+    std::vector<TaskRef> ready;
+    {
+        std::lock_guard<std::mutex> lock(task->lock);
+        task->done.store(true, std::memory_order_release);
+        ready.swap(task->successors);
+    }
+    for (TaskRef const & next : ready) {
+        if (--next->pending == 0) {
+            this->push(next);
+        }
+    }
+}
+
+void JobSystem::worker_main(int index) {
+    tls_worker = index;
+    Worker& self = *this->workers[index];
+
+    while (!this->stopping) {
+        if (this->run_one(index)) {
+            continue;
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        {
+            std::unique_lock<std::mutex> lock(this->sleep_lock);
+            this->sleep_cv.wait_for(lock, std::chrono::milliseconds(1), [this] {
+                return this->stopping || this->queued > 0;
+            });
+        }
+        std::chrono::nanoseconds idle = std::chrono::steady_clock::now() - start;
+        self.idle_ns.fetch_add((std::uint64_t)idle.count(), std::memory_order_relaxed);
+    }
+}
+
+// --- Statistics ---
+
+std::vector<JobSystem::WorkerStats> JobSystem::get_stats() const {
+    std::vector<WorkerStats> stats(this->workers.size());
+    for (std::size_t i = 0; i < this->workers.size(); ++i) {
+        Worker const & w = *this->workers[i];
+        stats[i].executed = w.executed.load(std::memory_order_relaxed);
+        stats[i].steals = w.steals.load(std::memory_order_relaxed);
+        stats[i].failed_steals = w.failed_steals.load(std::memory_order_relaxed);
+        stats[i].idle_seconds = w.idle_ns.load(std::memory_order_relaxed) * 1e-9;
+    }
+    return stats;
+}
+
+void JobSystem::reset_stats() {
+    for (std::unique_ptr<Worker> const & w : this->workers) {
+        w->executed = 0;
+        w->steals = 0;
+        w->failed_steals = 0;
+        w->idle_ns = 0;
+    }
+}
@@ -0,0 +1,139 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief Work-stealing task scheduler shared by the simulation, analytics and rendering.
+ * * A JobSystem with N threads starts N - 1 workers; the thread that calls
+ * wait() or parallel_for() (normally the main thread) acts as worker 0 and
+ * executes tasks while it waits, so nested parallel loops inside tasks never
+ * block a worker. Each worker owns a deque: it pushes and pops at the back,
+ * idle workers steal from the front of the others.
+ * * Only one thread the scheduler did not start may submit to or wait on a
+ * JobSystem: every such thread shares worker slot 0, so per-worker state
+ * (its deque, and per-slot accumulators indexed by current_worker()) would
+ * be shared between them. Use one JobSystem per external thread.
+ * * A frame is expressed as a small task graph: create() tasks, connect them
+ * with depend(), submit() them all and wait() on the last one.
+ */
+class JobSystem {
+public:
+    struct Task;
+    typedef std::shared_ptr<Task> TaskRef;
+
+    /**
+     * @brief Per-worker counters, for tuning chunk sizes and thread counts.
+     */
+    struct WorkerStats {
+        std::uint64_t executed = 0;      // Tasks run by this worker
+        std::uint64_t steals = 0;        // Tasks taken from another worker's deque
+        std::uint64_t failed_steals = 0; // Steal rounds that found nothing
+        double idle_seconds = 0.0;       // Time spent sleeping for lack of work
+    };
+
+    /**
+     * @param threads Total thread count including the caller (0 = hardware concurrency).
+     */
+    explicit JobSystem(int threads = 0);
+
+    /**
+     * @brief Stops and joins the workers. Tasks still queued are not run.
+     */
+    ~JobSystem();
+
+    JobSystem(JobSystem const &) = delete;
+    JobSystem& operator=(JobSystem const &) = delete;
+
+    int get_thread_count() const { return (int)this->workers.size(); }
+
+    /**
+     * @brief Index of the calling thread's worker slot (0 for non-worker threads,
+     * which is why only one of them may use a given JobSystem).
+     */
+    static int current_worker();
+
+    // --- Task graph ---
+
+    /**
+     * @brief Creates a task that has not been scheduled yet.
+     */
+    TaskRef create(std::function<void()> fn);
+
+    /**
+     * @brief Makes `task` wait for `before` to finish. Both must be created but
+     * `task` not yet submitted.
+     */
+    void depend(TaskRef const & task, TaskRef const & before);
+
+    /**
+     * @brief Schedules the task; it runs once all its dependencies are done.
+     */
+    void submit(TaskRef const & task);
+
+    /**
+     * @brief Runs other tasks until `task` has finished.
+     */
+    void wait(TaskRef const & task);
+
+    // --- Data parallelism ---
+
+    /**
+     * @brief Calls body(begin, end) over disjoint subranges covering [begin, end)
+     * and returns when all are done.
+     * * Ranges are split lazily: a worker halves its range and exposes the
+     * other half for stealing only while its own deque is short, so chunks
+     * stay large when every worker is busy and get finer when some are idle.
+     * @param grain Smallest range that is split further (0 = automatic).
+     */
+    void parallel_for(int begin, int end, std::function<void(int, int)> body, int grain = 0);
+
+    // --- Statistics ---
+
+    std::vector<WorkerStats> get_stats() const;
+    void reset_stats();
+
+    struct Task {
+        std::function<void()> fn;
+        std::atomic<int> pending{1};  // Unfinished dependencies + 1 until submitted
+        std::atomic<bool> done{false};
+        std::mutex lock;              // Guards successors against concurrent completion
+        std::vector<TaskRef> successors;
+    };
+
+private:
+    struct Worker {
+        std::mutex lock;
+        std::deque<TaskRef> queue;
+
+        std::atomic<std::uint64_t> executed{0};
+        std::atomic<std::uint64_t> steals{0};
+        std::atomic<std::uint64_t> failed_steals{0};
+        std::atomic<std::uint64_t> idle_ns{0};
+    };
+
+    struct ForLoop;
+
+    void worker_main(int index);
+    void push(TaskRef const & task);
+    bool run_one(int index);
+    TaskRef pop_local(int index);
+    TaskRef steal(int index);
+    void execute(TaskRef const & task, int index);
+    void run_range(std::shared_ptr<ForLoop> const & loop, int begin, int end);
+
+    std::vector<std::unique_ptr<Worker>> workers;
+    std::vector<std::thread> threads;
+
+    std::atomic<int> queued{0};   // Tasks sitting in any deque
+    std::atomic<bool> stopping{false};
+    std::mutex sleep_lock;
+    std::condition_variable sleep_cv;
+};
@@ -0,0 +1,109 @@
+#include "layer_cache.h"
+
+LayerCache::LayerCache(SDL_Renderer* renderer, int width, int height)
+    : renderer(renderer), width(width), height(height) {}
+
+LayerCache::~LayerCache() {
+    this->drop_textures();
+}
+
+int LayerCache::add(Painter paint, bool opaque) {
+    Layer layer;
+    layer.paint = std::move(paint);
+    layer.opaque = opaque;
+    this->layers.push_back(std::move(layer));
+    return (int)this->layers.size() - 1;
+}
+
+void LayerCache::invalidate(int layer) {
+    this->layers[layer].dirty = true;
+}
+
+void LayerCache::invalidate_all() {
+    for (Layer& layer : this->layers) {
+        layer.dirty = true;
+    }
+}
+
+void LayerCache::set_visible(int layer, bool visible) {
+    this->layers[layer].visible = visible;
+}
+
+void LayerCache::resize(int width, int height) {
+    if (width == this->width && height == this->height) {
+        return;
+    }
+    this->width = width;
+    this->height = height;
+    this->drop_textures();
+}
+
+void LayerCache::drop_textures() {
+    for (Layer& layer : this->layers) {
+        if (layer.texture) {
+            SDL_DestroyTexture(layer.texture);
+            layer.texture = nullptr;
+        }
+        layer.dirty = true;
+    }
+}
+
+void LayerCache::handle_event(SDL_Event const & event) {
+    switch (event.type) {
+        case SDL_RENDER_TARGETS_RESET:
+            // Target textures survive but their contents are lost
+            this->invalidate_all();
+            break;
+        case SDL_RENDER_DEVICE_RESET:
+            this->drop_textures();
+            break;
+        case SDL_WINDOWEVENT:
+            if (event.window.event == SDL_WINDOWEVENT_SIZE_CHANGED) {
+                this->resize(event.window.data1, event.window.data2);
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+bool LayerCache::repaint(Layer& layer) {
+    if (!layer.texture) {
+        layer.texture = SDL_CreateTexture(this->renderer, SDL_PIXELFORMAT_RGBA8888,
+                                          SDL_TEXTUREACCESS_TARGET, this->width, this->height);
+        if (!layer.texture) {
+            return false;
+        }
+        SDL_SetTextureBlendMode(layer.texture, layer.opaque ? SDL_BLENDMODE_NONE : SDL_BLENDMODE_BLEND);
+    }
+
+    SDL_SetRenderTarget(this->renderer, layer.texture);
+    SDL_SetRenderDrawColor(this->renderer, 0, 0, 0, SDL_ALPHA_TRANSPARENT);
+    SDL_RenderClear(this->renderer);
+    layer.paint(this->renderer, this->width, this->height);
+    layer.dirty = false;
+    this->stats.repaints++;
+    return true;
+}
+
+void LayerCache::composite(int first, int last) {
+    SDL_Texture* target = SDL_GetRenderTarget(this->renderer);
+
+    for (int i = first; i < last; ++i) {
+        Layer& layer = this->layers[i];
+        if (!layer.visible) {
+            continue;
+        }
+        if (layer.dirty || !layer.texture) {
+            if (!this->repaint(layer)) {
+                // No render-target support: draw directly, uncached
+                SDL_SetRenderTarget(this->renderer, target);
+                layer.paint(this->renderer, this->width, this->height);
+                continue;
+            }
+            SDL_SetRenderTarget(this->renderer, target);
+        }
+        SDL_RenderCopy(this->renderer, layer.texture, NULL, NULL);
+        this->stats.copies++;
+    }
+}
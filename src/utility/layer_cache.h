@@ -0,0 +1,87 @@
+#pragma once
+
+#include <SDL2/SDL.h>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+/**
+ * @brief Static render layers rasterized once into target textures.
+ * * Each layer has a paint callback that draws it in screen space. The first
+ * composite() after the layer was added or invalidated runs the callback
+ * into the layer's texture; every other frame only copies the texture (one
+ * SDL_RenderCopy per visible layer). Layers are composited in the order they
+ * were added, so static backgrounds go under the boids and overlays go on
+ * top by calling composite() with the matching range.
+ * * Compositing a layer costs a full-window texture copy every frame, so
+ * only cache content that is expensive to draw (many primitives); a clear or
+ * a few lines is cheaper to draw directly.
+ * * Textures are dropped on resize and on SDL_RENDER_DEVICE_RESET, and
+ * repainted on SDL_RENDER_TARGETS_RESET, so callers only need to invalidate
+ * layers whose content changed (e.g. after a camera move).
+ */
+class LayerCache {
+public:
+    using Painter = std::function<void(SDL_Renderer*, int width, int height)>;
+
+    struct Stats {
+        std::uint64_t repaints = 0; // Callback runs
+        std::uint64_t copies = 0;   // Cached textures composited
+    };
+
+    LayerCache(SDL_Renderer* renderer, int width, int height);
+    ~LayerCache();
+
+    LayerCache(LayerCache const &) = delete;
+    LayerCache& operator=(LayerCache const &) = delete;
+
+    /**
+     * @brief Adds a layer on top of the existing ones.
+     * @param opaque True if the painter covers every pixel (no blending needed).
+     * @return The layer id.
+     */
+    int add(Painter paint, bool opaque);
+
+    void invalidate(int layer);
+    void invalidate_all();
+
+    void set_visible(int layer, bool visible);
+    bool is_visible(int layer) const { return this->layers[layer].visible; }
+
+    /**
+     * @brief Changes the layer size (drops every texture).
+     */
+    void resize(int width, int height);
+
+    /**
+     * @brief Reacts to window resizes and render target/device resets.
+     */
+    void handle_event(SDL_Event const & event);
+
+    /**
+     * @brief Draws layers [first, last) onto the current render target,
+     * repainting the invalid ones first. The render target is restored.
+     */
+    void composite(int first, int last);
+    void composite() { this->composite(0, (int)this->layers.size()); }
+
+    Stats get_stats() const { return this->stats; }
+
+private:
+    struct Layer {
+        Painter paint;
+        bool opaque = false;
+        bool visible = true;
+        bool dirty = true;
+        SDL_Texture* texture = nullptr;
+    };
+
+    void drop_textures();
+    bool repaint(Layer& layer);
+
+    SDL_Renderer* renderer;
+    int width;
+    int height;
+    std::vector<Layer> layers;
+    Stats stats;
+};
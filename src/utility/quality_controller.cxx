@@ -0,0 +1,125 @@
+#include "quality_controller.h"
+#include <algorithm>
+#include <iostream>
+
+// Out-of-class definition: std::min below binds a reference to it
+const int QualityController::MAX_BACKOFF;
+
+QualityController::QualityController(Config const & config) : config(config) {
+    this->config.max_substeps = std::max(1, this->config.max_substeps);
+    this->state.active_boids = this->config.max_boids;
+}
+
+char const * QualityController::lod_name(Lod lod) {
+    switch (lod) {
+        case Lod::TRIANGLES: return "triangles";
+        case Lod::POINTS: return "points";
+        case Lod::HEATMAP: return "heatmap";
+    }
+    return "?";
+}
+
+bool QualityController::record(double update_ms, double render_ms) {
+    this->frame++;
+    if (!this->primed) {
+        this->update_avg = update_ms;
+        this->render_avg = render_ms;
+        this->primed = true;
+    } else {
+        double const a = this->config.smoothing;
+        this->update_avg += a * (update_ms - this->update_avg);
+        this->render_avg += a * (render_ms - this->render_avg);
+    }
+
+    if (this->improve_wait > 0) {
+        this->improve_wait--;
+    }
+    if (this->hold > 0) {
+        // Let the averages settle on the new settings
+        this->hold--;
+        return false;
+    }
+
+    double const frame_ms = this->get_frame_ms();
+    this->over = frame_ms > this->config.degrade_at * this->config.budget_ms ? this->over + 1 : 0;
+    this->under = frame_ms < this->config.improve_at * this->config.budget_ms ? this->under + 1 : 0;
+
+    bool changed = false;
+    if (this->over >= this->config.confirm_frames) {
+        changed = this->degrade();
+        if (changed) {
+            // Reverting a recent upgrade: that level does not fit, try less often
+            bool reverted = this->last_improve > 0
+                         && this->frame - this->last_improve < 2 * (std::uint64_t)this->config.hold_frames;
+            this->backoff = reverted ? std::min(this->backoff * 2, MAX_BACKOFF) : 1;
+            this->improve_wait = this->config.hold_frames * this->backoff;
+        }
+    } else if (this->under >= this->config.confirm_frames && this->improve_wait == 0) {
+        changed = this->improve();
+        if (changed) {
+            this->last_improve = this->frame;
+        }
+    }
+    if (changed) {
+        this->over = 0;
+        this->under = 0;
+        this->hold = this->config.hold_frames;
+        this->changes++;
+    }
+    return changed;
+}
+
+bool QualityController::degrade() {
+    bool const sim_bound = this->update_avg >= this->render_avg;
+
+    // Cheapest loss first: substeps when the simulation dominates, detail otherwise
+    if (sim_bound && this->state.substeps > 1) {
+        this->state.substeps--;
+        this->log("lower", "substeps " + std::to_string(this->state.substeps));
+        return true;
+    }
+    if (this->state.lod != Lod::HEATMAP) {
+        this->state.lod = (Lod)((int)this->state.lod + 1);
+        this->log("lower", std::string("lod ") + lod_name(this->state.lod));
+        return true;
+    }
+    if (this->state.substeps > 1) {
+        this->state.substeps--;
+        this->log("lower", "substeps " + std::to_string(this->state.substeps));
+        return true;
+    }
+    if (this->config.scale_boids && this->state.active_boids > this->config.min_boids) {
+        int n = (int)(this->state.active_boids * this->config.boid_step);
+        this->state.active_boids = std::max(n, this->config.min_boids);
+        this->log("lower", "active boids " + std::to_string(this->state.active_boids));
+        return true;
+    }
+    return false;
+}
+
+bool QualityController::improve() {
+    // Undo in reverse order: boids, then detail, then substeps
+    if (this->config.scale_boids && this->state.active_boids < this->config.max_boids) {
+        int n = (int)(this->state.active_boids / this->config.boid_step) + 1;
+        this->state.active_boids = std::min(n, this->config.max_boids);
+        this->log("raise", "active boids " + std::to_string(this->state.active_boids));
+        return true;
+    }
+    if (this->state.lod != Lod::TRIANGLES) {
+        this->state.lod = (Lod)((int)this->state.lod - 1);
+        this->log("raise", std::string("lod ") + lod_name(this->state.lod));
+        return true;
+    }
+    if (this->state.substeps < this->config.max_substeps) {
+        this->state.substeps++;
+        this->log("raise", "substeps " + std::to_string(this->state.substeps));
+        return true;
+    }
+    return false;
+}
+
+void QualityController::log(char const * direction, std::string const & what) const {
+    std::cerr << "quality: frame " << this->frame << ": " << direction << " " << what
+              << " (update " << this->update_avg << " ms + render " << this->render_avg
+              << " ms vs budget " << this->config.budget_ms << " ms)\n";
+}
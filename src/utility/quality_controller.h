@@ -0,0 +1,88 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+/**
+ * @brief Adjusts simulation and render quality to hold a frame budget.
+ * * Fed with the measured update and render time of every frame, it keeps
+ * an exponential moving average of both. When the average frame time stays
+ * above `degrade_at` * budget it lowers one setting, when it stays below
+ * `improve_at` * budget it raises one. The gap between the two thresholds,
+ * the number of consecutive frames required and a hold period after every
+ * change give the hysteresis that prevents oscillating between levels. An
+ * upgrade that has to be undone soon after doubles the wait before the next
+ * upgrade attempt (up to MAX_BACKOFF times the hold period).
+ * * Which setting moves depends on where the time goes: simulation-bound
+ * frames drop substeps first, render-bound frames drop the level of detail
+ * first, and the active boid count is the last resort (if enabled).
+ * Improvements undo these steps in reverse order; substeps only go above 1
+ * when `max_substeps` allows it. Every change is logged
+ * with the measurements that triggered it.
+ */
+class QualityController {
+public:
+    enum class Lod { TRIANGLES = 0, POINTS = 1, HEATMAP = 2 };
+
+    static const int MAX_BACKOFF = 16; // Cap of the upgrade wait multiplier
+
+    struct Config {
+        double budget_ms = 16.6;
+        double degrade_at = 0.95;    // Fraction of the budget that triggers a downgrade
+        double improve_at = 0.6;     // Fraction of the budget that allows an upgrade
+        int confirm_frames = 10;     // Consecutive frames past a threshold before acting
+        int hold_frames = 60;        // Frames to wait after a change before the next one
+        double smoothing = 0.1;      // EMA weight of the newest frame
+        int max_substeps = 1;        // Raised above 1 only on request: more substeps cost CPU
+        bool scale_boids = false;    // Allow lowering the active boid count
+        int max_boids = 0;           // Full flock size (needed when scale_boids is on)
+        int min_boids = 0;
+        double boid_step = 0.75;     // Factor applied to the boid count per change
+    };
+
+    struct State {
+        Lod lod = Lod::TRIANGLES;
+        int substeps = 1;
+        int active_boids = 0;
+    };
+
+    explicit QualityController(Config const & config);
+
+    /**
+     * @brief Records one frame's timings and possibly changes the state.
+     * @return True if the state changed.
+     */
+    bool record(double update_ms, double render_ms);
+
+    State const & get_state() const { return this->state; }
+    double get_frame_ms() const { return this->update_avg + this->render_avg; }
+    std::uint64_t get_changes() const { return this->changes; }
+
+    /**
+     * @brief Current multiplier of the wait before the next upgrade attempt
+     * (1 normally, doubled for each quickly reverted upgrade up to MAX_BACKOFF).
+     */
+    int get_backoff() const { return this->backoff; }
+
+    static char const * lod_name(Lod lod);
+
+private:
+    bool degrade();
+    bool improve();
+    void log(char const * direction, std::string const & what) const;
+
+    Config config;
+    State state;
+
+    double update_avg = 0.0;
+    double render_avg = 0.0;
+    bool primed = false;
+    int over = 0;   // Consecutive frames above the degrade threshold
+    int under = 0;  // Consecutive frames below the improve threshold
+    int hold = 0;
+    int backoff = 1;                // Multiplier of the wait before upgrading again
+    int improve_wait = 0;           // Frames until the next upgrade is allowed
+    std::uint64_t last_improve = 0; // Frame of the last upgrade
+    std::uint64_t frame = 0;
+    std::uint64_t changes = 0;
+};
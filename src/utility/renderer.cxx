@@ -1,8 +1,25 @@
 #include "renderer.h"
+#include "job_system.h"
+#include <algorithm>
 #include <cmath>
 
 namespace Renderer {
 
+    // Indices of the boids inside the camera's view (grown by margin), via the grid
+    static void collect_visible(const Flock& flock, const Camera& camera, float margin, std::vector<int>& visible) {
+        float x0, y0, x1, y1;
+        camera.visible_rect(margin, x0, y0, x1, y1);
+
+        const std::vector<Boid>& boids = flock.get_boids();
+        visible.clear();
+        flock.get_grid().for_each_in_rect(x0, y0, x1, y1, [&](int i) {
+            const Vec2& p = boids[i].position;
+            if (p.x >= x0 && p.x <= x1 && p.y >= y0 && p.y <= y1) {
+                visible.push_back(i);
+            }
+        });
+    }
+
     void draw_oriented_boid(SDL_Renderer* renderer, const Boid& b, float size) {
         
         // Use a small constant to check if the boid is moving. 
@@ -53,4 +70,119 @@ namespace Renderer {
         // Line 3: Back-left to Tip
         SDL_RenderDrawLine(renderer, (int)x2, (int)y2, (int)x0, (int)y0);
     }
-}
\ No newline at end of file
+
+    int build_flock_outlines(const Flock& flock, const Camera& camera, float size,
+                             std::vector<SDL_Point>& outlines, JobSystem* jobs) {
+        // Keep boids visible as a few pixels when zoomed far out
+        float const screen_size = std::max(size * camera.zoom, 2.0f);
+
+        // 1. Cull with the grid (cheap, serial)
+        const std::vector<Boid>& boids = flock.get_boids();
+        std::vector<int> visible;
+        collect_visible(flock, camera, size, visible);
+
+        // 2. One closed outline per boid, same shape as draw_oriented_boid.
+        // The wing directions are the heading rotated by +-135 degrees.
+        float const C = -0.70710678f; // cos(135 deg)
+        float const S = 0.70710678f;  // sin(135 deg)
+
+        int const n = (int)visible.size();
+        outlines.resize(4 * (std::size_t)n);
+        auto build = [&](int begin, int end) {
+            for (int k = begin; k < end; ++k) {
+                const Boid& b = boids[visible[k]];
+                Vec2 c = camera.world_to_screen(b.position);
+
+                // Stationary boids have no heading; point them along +x
+                Vec2 dir = b.velocity.magnitude_sq() < 0.01f ? Vec2{1.0f, 0.0f} : b.velocity.normalize();
+                Vec2 right = {dir.x * C + dir.y * S, -dir.x * S + dir.y * C};
+                Vec2 left = {dir.x * C - dir.y * S, dir.x * S + dir.y * C};
+
+                SDL_Point* v = &outlines[4 * (std::size_t)k];
+                Vec2 tip = c + dir * screen_size;
+                Vec2 back_right = c + right * (screen_size * 0.7f);
+                Vec2 back_left = c + left * (screen_size * 0.7f);
+                v[0] = {(int)tip.x, (int)tip.y};
+                v[1] = {(int)back_right.x, (int)back_right.y};
+                v[2] = {(int)back_left.x, (int)back_left.y};
+                v[3] = v[0];
+            }
+        };
+        if (jobs) {
+            jobs->parallel_for(0, n, build);
+        } else {
+            build(0, n);
+        }
+        return n;
+    }
+
+    void draw_outlines(SDL_Renderer* renderer, const std::vector<SDL_Point>& outlines) {
+        SDL_SetRenderDrawColor(renderer, 0, 0, 255, SDL_ALPHA_OPAQUE);
+        for (std::size_t k = 0; k + 4 <= outlines.size(); k += 4) {
+            SDL_RenderDrawLines(renderer, &outlines[k], 4);
+        }
+    }
+
+    int build_flock_points(const Flock& flock, const Camera& camera, std::vector<SDL_Point>& points) {
+        const std::vector<Boid>& boids = flock.get_boids();
+        std::vector<int> visible;
+        collect_visible(flock, camera, 0.0f, visible);
+
+        points.resize(visible.size());
+        for (std::size_t k = 0; k < visible.size(); ++k) {
+            Vec2 c = camera.world_to_screen(boids[visible[k]].position);
+            points[k] = {(int)c.x, (int)c.y};
+        }
+        return (int)points.size();
+    }
+
+    void draw_points(SDL_Renderer* renderer, const std::vector<SDL_Point>& points) {
+        if (!points.empty()) {
+            SDL_SetRenderDrawColor(renderer, 0, 0, 255, SDL_ALPHA_OPAQUE);
+            SDL_RenderDrawPoints(renderer, points.data(), (int)points.size());
+        }
+    }
+
+    int build_density(const Flock& flock, const Camera& camera, int cols, int rows,
+                      std::vector<Uint32>& pixels) {
+        const std::vector<Boid>& boids = flock.get_boids();
+        std::vector<int> visible;
+        collect_visible(flock, camera, 0.0f, visible);
+
+        // 1. Count boids per screen cell
+        std::vector<int> counts((std::size_t)cols * rows, 0);
+        float const sx = (float)cols / camera.view_width;
+        float const sy = (float)rows / camera.view_height;
+        int peak = 0;
+        for (int i : visible) {
+            Vec2 c = camera.world_to_screen(boids[i].position);
+            int cx = std::min(std::max((int)(c.x * sx), 0), cols - 1);
+            int cy = std::min(std::max((int)(c.y * sy), 0), rows - 1);
+            peak = std::max(peak, ++counts[(std::size_t)cy * cols + cx]);
+        }
+
+        // 2. Blue with alpha on a log scale of the count (RGBA8888)
+        pixels.resize(counts.size());
+        float const norm = peak > 0 ? 1.0f / std::log1p((float)peak) : 0.0f;
+        for (std::size_t k = 0; k < counts.size(); ++k) {
+            Uint32 alpha = counts[k] > 0 ? (Uint32)(64.0f + 191.0f * std::log1p((float)counts[k]) * norm) : 0u;
+            pixels[k] = 0x0000FF00u | alpha;
+        }
+        return (int)visible.size();
+    }
+
+    void draw_boundaries(SDL_Renderer* renderer, int width, int height) {
+        SDL_SetRenderDrawColor(renderer, 128, 128, 128, SDL_ALPHA_OPAQUE);
+        SDL_Rect r = { 0, 0, width, height };
+        SDL_RenderDrawRect(renderer, &r);
+    }
+
+    void draw_boundaries(SDL_Renderer* renderer, const Camera& camera) {
+        Vec2 a = camera.world_to_screen(Vec2{0.0f, 0.0f});
+        Vec2 b = camera.world_to_screen(Vec2{camera.world_width, camera.world_height});
+        SDL_SetRenderDrawColor(renderer, 128, 128, 128, SDL_ALPHA_OPAQUE);
+        SDL_Rect r = { (int)std::floor(a.x), (int)std::floor(a.y),
+                       (int)std::ceil(b.x - a.x), (int)std::ceil(b.y - a.y) };
+        SDL_RenderDrawRect(renderer, &r);
+    }
+}
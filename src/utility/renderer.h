@@ -1,8 +1,13 @@
 #pragma once
 
 #include <SDL2/SDL.h>
+#include <vector>
 #include "model/boid.h" // Requires Boid structure definition
 #include "model/vec2.h" // Requires Vec2 structure definition
+#include "model/flock.h"
+#include "camera.h"
+
+class JobSystem;
 
 namespace Renderer {
     /**
@@ -13,6 +18,43 @@ namespace Renderer {
      * @param size The physical size (half-length) of the boid triangle.
      */
     void draw_oriented_boid(SDL_Renderer* renderer, const Boid& b, float size);
+
+    /**
+     * @brief Computes the triangle outline (as drawn by draw_oriented_boid) of
+     * every boid inside the camera's view.
+     * * Visible boids are collected from the spatial grid, so the cost follows
+     * the number of boids on screen, not the flock size. Their outlines are
+     * then computed in parallel on the job system (if given). This only reads
+     * the flock, so it can run as a task while the main thread is busy; the
+     * outlines are drawn later with draw_outlines().
+     * @param outlines Output, resized to 4 points (tip, right, left, tip) per visible boid.
+     * @param jobs Job system to split the work on (nullptr = run on the caller).
+     * @return The number of boids in the buffer.
+     */
+    int build_flock_outlines(const Flock& flock, const Camera& camera, float size,
+                             std::vector<SDL_Point>& outlines, JobSystem* jobs);
+
+    /**
+     * @brief Draws the outlines built by build_flock_outlines().
+     */
+    void draw_outlines(SDL_Renderer* renderer, const std::vector<SDL_Point>& outlines);
+
+    /**
+     * @brief Cheaper level of detail: one screen point per visible boid.
+     * @return The number of boids in the buffer.
+     */
+    int build_flock_points(const Flock& flock, const Camera& camera, std::vector<SDL_Point>& points);
+    void draw_points(SDL_Renderer* renderer, const std::vector<SDL_Point>& points);
+
+    /**
+     * @brief Cheapest level of detail: boid density over a cols x rows grid
+     * laid over the screen, as RGBA8888 pixels ready for a streaming texture
+     * (blue, alpha growing with the logarithm of the count). The cost does not
+     * depend on the zoom or on how boids overlap on screen.
+     * @return The number of visible boids counted.
+     */
+    int build_density(const Flock& flock, const Camera& camera, int cols, int rows,
+                      std::vector<Uint32>& pixels);
     
     /**
      * @brief Draws the target/nest the boids are moving towards.
@@ -28,4 +70,10 @@ namespace Renderer {
      * @param height The screen height.
      */
     void draw_boundaries(SDL_Renderer* renderer, int width, int height);
+
+    /**
+     * @brief Outlines the world rectangle as seen through the camera.
+     */
+    void draw_boundaries(SDL_Renderer* renderer, const Camera& camera);
+
 }
\ No newline at end of file
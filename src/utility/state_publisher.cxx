@@ -0,0 +1,103 @@
+#include "state_publisher.h"
+#include <ctime>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+std::int64_t state_ring::monotonic_ns() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (std::int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+StatePublisher::StatePublisher(std::string const & name, std::uint32_t max_boids, float world_width,
+                               float world_height, std::uint32_t slots)
+    : name(name) {
+
+    if (slots < 2) {
+        slots = 2;
+    }
+    std::size_t const slot_bytes = state_ring::slot_bytes_for(max_boids);
+    this->bytes = sizeof(state_ring::RingHeader) + slots * slot_bytes;
+
+    // A stale segment from a crashed run may have another size or version
+    shm_unlink(name.c_str());
+    int fd = shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0644);
+    if (fd < 0) {
+        return;
+    }
+    if (ftruncate(fd, (off_t)this->bytes) != 0) {
+        close(fd);
+        shm_unlink(name.c_str());
+        return;
+    }
+    void * map = mmap(nullptr, this->bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        shm_unlink(name.c_str());
+        return;
+    }
+
+    // The new object is zero-filled: every slot sequence starts at 0 (empty)
+    state_ring::RingHeader * h = static_cast<state_ring::RingHeader *>(map);
+    h->header_bytes = sizeof(state_ring::RingHeader);
+    h->slot_count = slots;
+    h->slot_bytes = slot_bytes;
+    h->max_boids = max_boids;
+    h->record_bytes = sizeof(state_ring::BoidRecord);
+    h->world_width = world_width;
+    h->world_height = world_height;
+    h->latest.store(0, std::memory_order_relaxed);
+    h->publisher_alive.store(1, std::memory_order_relaxed);
+    h->version = state_ring::VERSION;
+    // Readers check the magic last, so it is written last
+    std::atomic_thread_fence(std::memory_order_release);
+    h->magic = state_ring::MAGIC;
+
+    this->base = map;
+}
+
+StatePublisher::~StatePublisher() {
+    if (!this->base) {
+        return;
+    }
+    static_cast<state_ring::RingHeader *>(this->base)->publisher_alive.store(0, std::memory_order_release);
+    munmap(this->base, this->bytes);
+    shm_unlink(this->name.c_str());
+}
+
+void StatePublisher::publish(const std::vector<Boid>& boids, std::uint64_t step) {
+    if (!this->base) {
+        return;
+    }
+    state_ring::RingHeader * h = static_cast<state_ring::RingHeader *>(this->base);
+    std::uint64_t const frame = ++this->frame;
+    state_ring::SlotHeader * slot = state_ring::slot_at(this->base, frame);
+
+    // Seqlock write: odd sequence, fence, payload, even sequence (release)
+    slot->sequence.store(2 * frame - 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    std::uint32_t const total = (std::uint32_t)boids.size();
+    std::uint32_t const count = total < h->max_boids ? total : h->max_boids;
+    state_ring::BoidRecord * out = state_ring::records_of(slot);
+    for (std::uint32_t i = 0; i < count; ++i) {
+        out[i].px = boids[i].position.x;
+        out[i].py = boids[i].position.y;
+        out[i].vx = boids[i].velocity.x;
+        out[i].vy = boids[i].velocity.y;
+    }
+    slot->frame = frame;
+    slot->step = step;
+    slot->count = count;
+    slot->total = total;
+    slot->publish_ns = state_ring::monotonic_ns();
+
+    slot->sequence.store(2 * frame, std::memory_order_release);
+    h->latest.store(frame, std::memory_order_release);
+
+    this->stats.published++;
+    if (count < total) {
+        this->stats.truncated++;
+    }
+}
@@ -0,0 +1,126 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "../model/boid.h"
+
+/**
+ * @brief Layout of the shared-memory state ring (shared with readers).
+ * * The segment starts with a RingHeader, followed by slot_count slots of
+ * slot_bytes each. A slot is a SlotHeader followed by `count` BoidRecords.
+ * Frame n (n >= 1) goes to slot n % slot_count.
+ * * Each slot is a seqlock: the writer makes `sequence` odd, writes the
+ * frame, then stores 2 * n. A reader loads `sequence` (acquire), reads the
+ * slot in place, then re-loads it after an acquire fence; the frame is
+ * consistent if both loads match and are even. `latest` holds the number of
+ * the newest complete frame (0 = none yet).
+ * * Bump VERSION for any change to these structures.
+ */
+namespace state_ring {
+
+static const std::uint32_t MAGIC = 0x524b4c46u; // "FLKR"
+static const std::uint32_t VERSION = 1;
+
+static_assert(ATOMIC_LLONG_LOCK_FREE == 2, "the ring needs address-free 64-bit atomics");
+
+struct RingHeader {
+    std::uint32_t magic;
+    std::uint32_t version;
+    std::uint32_t header_bytes;  // sizeof(RingHeader), offset of slot 0
+    std::uint32_t slot_count;
+    std::uint64_t slot_bytes;    // Stride between slots
+    std::uint32_t max_boids;     // Records that fit in one slot
+    std::uint32_t record_bytes;  // sizeof(BoidRecord)
+    float world_width;
+    float world_height;
+    std::atomic<std::uint64_t> latest;
+    std::atomic<std::uint32_t> publisher_alive; // Cleared when the publisher shuts down
+    std::uint32_t reserved;
+};
+
+struct SlotHeader {
+    std::atomic<std::uint64_t> sequence; // Odd while being written, else 2 * frame
+    std::uint64_t frame;
+    std::uint64_t step;                  // Simulation step the state belongs to
+    std::int64_t publish_ns;             // CLOCK_MONOTONIC when the frame was completed
+    std::uint32_t count;                 // Records in this slot
+    std::uint32_t total;                 // Boids in the flock (> count if truncated)
+};
+
+struct BoidRecord {
+    float px, py;
+    float vx, vy;
+};
+
+/**
+ * @brief CLOCK_MONOTONIC in nanoseconds (comparable across processes).
+ */
+std::int64_t monotonic_ns();
+
+inline std::size_t slot_bytes_for(std::uint32_t max_boids) {
+    std::size_t bytes = sizeof(SlotHeader) + (std::size_t)max_boids * sizeof(BoidRecord);
+    return (bytes + 63) / 64 * 64; // Keep slots on separate cache lines
+}
+
+inline SlotHeader * slot_at(void * base, std::uint64_t frame) {
+    RingHeader * h = static_cast<RingHeader *>(base);
+    return reinterpret_cast<SlotHeader *>(static_cast<std::uint8_t *>(base) + h->header_bytes
+                                          + (frame % h->slot_count) * h->slot_bytes);
+}
+
+inline BoidRecord * records_of(SlotHeader * slot) {
+    return reinterpret_cast<BoidRecord *>(slot + 1);
+}
+
+}
+
+/**
+ * @brief Publishes each completed step's boid state into a POSIX shared-memory ring.
+ * * Single writer, any number of readers; readers never block the writer and
+ * need no locks (see state_ring). A slow reader only sees that a slot was
+ * overwritten and skips to the latest frame. Flocks larger than max_boids are
+ * truncated to the first max_boids boids.
+ */
+class StatePublisher {
+public:
+    struct Stats {
+        std::uint64_t published = 0;
+        std::uint64_t truncated = 0; // Frames that did not fit every boid
+    };
+
+    /**
+     * @brief Creates (or replaces) the shared-memory object.
+     * @param name POSIX shm name, e.g. "/ant-war".
+     * @param max_boids Capacity of each slot.
+     * @param slots Frames kept in the ring.
+     */
+    StatePublisher(std::string const & name, std::uint32_t max_boids, float world_width,
+                   float world_height, std::uint32_t slots = 4);
+
+    /**
+     * @brief Marks the ring as closed and unlinks it; mapped readers keep their view.
+     */
+    ~StatePublisher();
+
+    StatePublisher(StatePublisher const &) = delete;
+    StatePublisher& operator=(StatePublisher const &) = delete;
+
+    bool is_ok() const { return this->base != nullptr; }
+
+    /**
+     * @brief Writes the boids' state as the next frame.
+     */
+    void publish(const std::vector<Boid>& boids, std::uint64_t step);
+
+    Stats get_stats() const { return this->stats; }
+
+private:
+    std::string name;
+    void * base = nullptr;
+    std::size_t bytes = 0;
+    std::uint64_t frame = 0;
+    Stats stats;
+};